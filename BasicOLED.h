@@ -0,0 +1,209 @@
+#ifndef BasicOLED_h
+#define BasicOLED_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+#include "OLEDCommands.h"
+
+//
+// Compile-time specialized driver
+//
+// OLED works out the controller at runtime and talks through a heap-allocated,
+// virtual SerialContainer. When the board and display are known up front,
+// BasicOLED<Transport, Controller> does the same job with neither:
+//  * Transport is used directly (HardwareSerial, SoftwareSerial, PosixSerialContainer,
+//    anything with begin/available/read/write), held by reference, so writes inline.
+//  * Controller fixes the coordinate width, so Goldelox builds send 1-byte coordinates
+//    and Picaso builds send 2-byte ones without checking on every value.
+//
+// It covers the core drawing commands. Use OLED for SD, text styling, pipelining etc.
+// The command bytes come from OLEDCommands and the baud table from OLED, so the two
+// drivers differ only in how the bytes reach the port.
+//
+//   SoftwareSerial displaySerial(10, 9);
+//   BasicOLED<SoftwareSerial, OLEDGoldelox> oled(displaySerial, 8, 38400);
+//
+
+struct OLEDGoldelox
+{
+    static const uint8_t SpatialBytes = 1;
+    static const OLED::ControllerType Type = OLED::Goldelox;
+};
+
+struct OLEDPicaso
+{
+    static const uint8_t SpatialBytes = 2;
+    static const OLED::ControllerType Type = OLED::Picaso;
+};
+
+template <class Transport, class Controller>
+class BasicOLED
+{
+public:
+    BasicOLED(Transport &serial, uint8_t pinReset, uint32_t baudRate = OLED_BAUD_DEFAULT)
+        : _serial(serial), _pinReset(pinReset), _baudRate(baudRate) {}
+
+    bool init()
+    {
+        pinMode(_pinReset, OUTPUT);
+        for (uint8_t r = 0; r < OLED_INIT_RETRIES; r++)
+        {
+            reset();
+            delay(OLED_INIT_DELAY_MS);
+            _serial.begin(9600);
+            OLEDCommands::autoBaud(*this);
+            if (getAck() && setBaud(_baudRate))
+                return true;
+        }
+        return false;
+    }
+
+    void reset()
+    {
+        digitalWrite(_pinReset, LOW);
+        delay(OLED_RESET_DELAY_MS);
+        digitalWrite(_pinReset, HIGH);
+        delay(OLED_RESET_DELAY_MS);
+    }
+
+    bool setBaud(uint32_t baudRate)
+    {
+        uint8_t baudByte;
+        if (!OLED::getBaudByte(baudRate, baudByte))
+            return false;
+        OLEDCommands::baud(*this, baudByte);
+        _serial.flush();
+        _serial.begin(baudRate);
+        return getAck();
+    }
+
+    static OLED::ControllerType getControllerType() { return Controller::Type; }
+
+    inline void write(uint8_t value) { _serial.write(value); }
+
+    inline void writeShort(uint16_t value)
+    {
+        write(value >> 8);
+        write(value & 0xFF);
+    }
+
+    // SpatialBytes is a constant, so the compiler drops whichever branch doesn't apply.
+    inline void writeSpatial(uint16_t value)
+    {
+        if (Controller::SpatialBytes == 2)
+            write(value >> 8);
+        write(value & 0xFF);
+    }
+
+    bool getResponse(uint8_t &result)
+    {
+        uint32_t start = micros();
+        do
+        {
+            if (_serial.available())
+            {
+                result = _serial.read();
+                return true;
+            }
+        }
+        while (micros() - start < OLED_RESPONSE_TIMEOUT_MAX_US);
+        return false;
+    }
+
+    bool getResponseShort(uint16_t &result)
+    {
+        uint8_t byte1, byte2;
+        if (!getResponse(byte1) || !getResponse(byte2))
+            return false;
+        result = ((uint16_t)byte1 << 8) | byte2;
+        return true;
+    }
+
+    bool getAck()
+    {
+        uint8_t result;
+        return getResponse(result) && result == OLED_ACK;
+    }
+
+    bool clear()
+    {
+        OLEDCommands::clear(*this);
+        return getAck();
+    }
+
+    bool setFill(bool fillShapes)
+    {
+        OLEDCommands::fill(*this, fillShapes);
+        return getAck();
+    }
+
+    bool setBackground(uint16_t color)
+    {
+        OLEDCommands::background(*this, color);
+        return getAck();
+    }
+
+    bool readPixel(uint16_t x, uint16_t y, uint16_t &color)
+    {
+        OLEDCommands::readPixel(*this, x, y);
+        return getResponseShort(color);
+    }
+
+    bool drawPixel(uint16_t x, uint16_t y, uint16_t color)
+    {
+        OLEDCommands::pixel(*this, x, y, color);
+        return getAck();
+    }
+
+    bool drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+    {
+        OLEDCommands::line(*this, x1, y1, x2, y2, color);
+        return getAck();
+    }
+
+    bool drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+    {
+        OLEDCommands::rectangle(*this, x1, y1, x2, y2, color);
+        return getAck();
+    }
+
+    bool drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+        uint16_t x3, uint16_t y3, uint16_t color)
+    {
+        OLEDCommands::triangle(*this, x1, y1, x2, y2, x3, y3, color);
+        return getAck();
+    }
+
+    bool drawPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2])
+    {
+        if (numVertices < 3 || numVertices > OLED_MAX_POLYGON_VERTICES)
+            return false;
+        OLEDCommands::polygon(*this, numVertices);
+        for (uint8_t v = 0; v < numVertices; v++)
+            OLEDCommands::point(*this, vertices[v][0], vertices[v][1]);
+        writeShort(color);
+        return getAck();
+    }
+
+    bool drawCircle(uint16_t x, uint16_t y, uint16_t radius, uint16_t color)
+    {
+        OLEDCommands::circle(*this, x, y, radius, color);
+        return getAck();
+    }
+
+    bool screenCopyPaste(uint16_t sourceX, uint16_t sourceY, uint16_t destX, uint16_t destY,
+        uint16_t sourceWidth, uint16_t sourceHeight)
+    {
+        OLEDCommands::copyPaste(*this, sourceX, sourceY, destX, destY, sourceWidth,
+            sourceHeight);
+        return getAck();
+    }
+
+private:
+    Transport &_serial;
+    uint8_t _pinReset;
+    uint32_t _baudRate;
+};
+
+#endif
@@ -44,6 +44,14 @@ Color Color::from32BitRGB(uint32_t colorLong)
         colorLong & 0xFF);
 }
 
+Color Color::from8BitRGB(uint8_t colorByte)
+{
+    return Color(
+        (colorByte >> 5) * 255 / 7,
+        (colorByte >> 2 & 0x07) * 255 / 7,
+        (colorByte & 0x03) * 255 / 3);
+}
+
 
 Color Color::rand()
 {
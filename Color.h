@@ -13,6 +13,8 @@ public:
     static Color fromRGB(uint8_t red, uint8_t green, uint8_t blue);
     static Color from16BitRGB(uint16_t colorShort);
     static Color from32BitRGB(uint32_t colorLong);
+    // RRRGGGBB, as in 8 bit images
+    static Color from8BitRGB(uint8_t colorByte);
 
     static Color rand();
     static Color rand(uint8_t max);
@@ -0,0 +1,1100 @@
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "EmulatorSerialContainer.h"
+
+#include "FourDuino.h"
+
+#define OLED_EMULATOR_UNKNOWN   0xFFFF
+
+// Classic 5x7 font, one byte per column, least significant bit at the top. 0x20-0x7E.
+static const uint8_t _font5x7[][5] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00},
+    {0x14,0x7F,0x14,0x7F,0x14}, {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62},
+    {0x36,0x49,0x56,0x20,0x50}, {0x00,0x08,0x07,0x03,0x00}, {0x00,0x1C,0x22,0x41,0x00},
+    {0x00,0x41,0x22,0x1C,0x00}, {0x2A,0x1C,0x7F,0x1C,0x2A}, {0x08,0x08,0x3E,0x08,0x08},
+    {0x00,0x80,0x70,0x30,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x00,0x60,0x60,0x00},
+    {0x20,0x10,0x08,0x04,0x02}, {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00},
+    {0x72,0x49,0x49,0x49,0x46}, {0x21,0x41,0x49,0x4D,0x33}, {0x18,0x14,0x12,0x7F,0x10},
+    {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x31}, {0x41,0x21,0x11,0x09,0x07},
+    {0x36,0x49,0x49,0x49,0x36}, {0x46,0x49,0x49,0x29,0x1E}, {0x00,0x00,0x14,0x00,0x00},
+    {0x00,0x40,0x34,0x00,0x00}, {0x00,0x08,0x14,0x22,0x41}, {0x14,0x14,0x14,0x14,0x14},
+    {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x59,0x09,0x06}, {0x3E,0x41,0x5D,0x59,0x4E},
+    {0x7C,0x12,0x11,0x12,0x7C}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+    {0x7F,0x41,0x41,0x41,0x3E}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01},
+    {0x3E,0x41,0x41,0x51,0x73}, {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00},
+    {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, {0x7F,0x40,0x40,0x40,0x40},
+    {0x7F,0x02,0x1C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46},
+    {0x26,0x49,0x49,0x49,0x32}, {0x03,0x01,0x7F,0x01,0x03}, {0x3F,0x40,0x40,0x40,0x3F},
+    {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, {0x63,0x14,0x08,0x14,0x63},
+    {0x03,0x04,0x78,0x04,0x03}, {0x61,0x59,0x49,0x4D,0x43}, {0x00,0x7F,0x41,0x41,0x41},
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x41,0x7F}, {0x04,0x02,0x01,0x02,0x04},
+    {0x40,0x40,0x40,0x40,0x40}, {0x00,0x03,0x07,0x08,0x00}, {0x20,0x54,0x54,0x78,0x40},
+    {0x7F,0x28,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x28}, {0x38,0x44,0x44,0x28,0x7F},
+    {0x38,0x54,0x54,0x54,0x18}, {0x00,0x08,0x7E,0x09,0x02}, {0x18,0xA4,0xA4,0x9C,0x78},
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x40,0x3D,0x00},
+    {0x7F,0x10,0x28,0x44,0x00}, {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x78,0x04,0x78},
+    {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, {0xFC,0x18,0x24,0x24,0x18},
+    {0x18,0x24,0x24,0x18,0xFC}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x24},
+    {0x04,0x04,0x3F,0x44,0x24}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C},
+    {0x3C,0x40,0x30,0x40,0x3C}, {0x44,0x28,0x10,0x28,0x44}, {0x4C,0x90,0x90,0x90,0x7C},
+    {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, {0x00,0x00,0x77,0x00,0x00},
+    {0x00,0x41,0x36,0x08,0x00}, {0x02,0x01,0x02,0x04,0x02}
+};
+
+// In OLED_PRM_BAUD_* order
+static const uint32_t _baudRates[] = { 110, 300, 600, 1200, 2400, 4800, 9600, 14400,
+    19200, 31250, 38400, 56000, 57600, 115200, 129032, 282353, 128000, 256000 };
+
+static uint8_t _getResolutionCode(uint16_t size)
+{
+    switch (size)
+    {
+    case 64: return OLED_RES_64;
+    case 96: return OLED_RES_96;
+    case 128: return OLED_RES_128;
+    case 160: return OLED_RES_160;
+    case 176: return OLED_RES_176;
+    case 220: return OLED_RES_220;
+    case 320: return OLED_RES_320;
+    default: return OLED_RES_UNKNOWN;
+    }
+}
+
+// Later of two times on a wrapping micros() clock
+static uint32_t _later(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) > 0 ? a : b;
+}
+
+EmulatorSerialContainer::EmulatorSerialContainer(uint16_t width, uint16_t height,
+    const char *sdImagePath)
+    : SerialContainer(), _width(width), _height(height), _screen(width, height), _sdImage(0),
+    _hostBaud(9600), _baudLimit(0), _timing(true), _commandUs(OLED_EMULATOR_COMMAND_US),
+    _pixelNs(OLED_EMULATOR_PIXEL_NS), _sdSectorUs(OLED_EMULATOR_SD_SECTOR_US)
+{
+    _spatialBytes = max(width, height) > 0xFF ? 2 : 1;
+    if (sdImagePath)
+    {
+        _sdImage = fopen(sdImagePath, "r+b");
+        if (!_sdImage)
+            _sdImage = fopen(sdImagePath, "w+b");
+    }
+    clearStats();
+    reset();
+}
+
+EmulatorSerialContainer::~EmulatorSerialContainer()
+{
+    if (_sdImage)
+        fclose(_sdImage);
+}
+
+void EmulatorSerialContainer::reset()
+{
+    _screen.clear(0x0000);
+    _autoBauded = false;
+    _deviceBaud = 0;
+    _background = 0x0000;
+    _fill = true;
+    _font = OLED_FONT_SMALL;
+    _fontOpaque = false;
+    memset(_userBitmaps, 0, sizeof(_userBitmaps));
+    _sdAddress = 0;
+    _sdInitialized = false;
+
+    _commandCount = 0;
+    _imagePixelsLeft = 0;
+    _responseHead = 0;
+    _responseCount = 0;
+    _overflow = false;
+    _silent = false;
+
+    uint32_t now = _now();
+    _rxFreeUs = now;
+    _deviceFreeUs = now;
+    _txFreeUs = now;
+}
+
+void EmulatorSerialContainer::begin(uint32_t baudRate) { _hostBaud = baudRate; }
+void EmulatorSerialContainer::end() {}
+
+int EmulatorSerialContainer::available()
+{
+    if (!_timing)
+        return _responseCount;
+    uint32_t now = _now();
+    uint16_t ready = 0;
+    while (ready < _responseCount &&
+        (int32_t)(now - _responses[(_responseHead + ready) % OLED_EMULATOR_RESPONSE_BUFFER].readyUs) >= 0)
+        ready++;
+    return ready;
+}
+
+int EmulatorSerialContainer::peek()
+{
+    if (available() == 0)
+        return -1;
+    const Response &response = _responses[_responseHead];
+    return _isGarbled(response.baudRate) ? _garble(response.data) : response.data;
+}
+
+int EmulatorSerialContainer::read()
+{
+    int data = peek();
+    if (data < 0)
+        return data;
+    if (_isGarbled(_responses[_responseHead].baudRate))
+        _stats.garbledBytes++;
+    _responseHead = (_responseHead + 1) % OLED_EMULATOR_RESPONSE_BUFFER;
+    _responseCount--;
+    return data;
+}
+
+// Waits for the line to finish sending everything written so far.
+void EmulatorSerialContainer::flush()
+{
+    if (!_timing)
+        return;
+    int32_t wait = (int32_t)(_rxFreeUs - _now());
+    if (wait > 0)
+        delayMicroseconds(wait);
+}
+
+bool EmulatorSerialContainer::overflow()
+{
+    bool result = _overflow;
+    _overflow = false;
+    return result;
+}
+
+size_t EmulatorSerialContainer::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+// Everything is parsed and drawn straight away; only the responses wait for the right time.
+// Like HardwareSerial, this blocks once more than OLED_EMULATOR_TX_BUFFER bytes are queued.
+size_t EmulatorSerialContainer::write(const uint8_t *buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        _receive(buffer[i]);
+
+    if (_timing)
+    {
+        int32_t backlog = (int32_t)(_rxFreeUs - _now());
+        int32_t allowed = OLED_EMULATOR_TX_BUFFER * _byteUs(_hostBaud);
+        if (backlog > allowed)
+            delayMicroseconds(backlog - allowed);
+    }
+    return size;
+}
+
+int EmulatorSerialContainer::availableForWrite()
+{
+    if (!_timing)
+        return OLED_EMULATOR_TX_BUFFER;
+    int32_t backlog = (int32_t)(_rxFreeUs - _now());
+    if (backlog <= 0)
+        return OLED_EMULATOR_TX_BUFFER;
+    int32_t queued = (backlog + _byteUs(_hostBaud) - 1) / _byteUs(_hostBaud);
+    return queued >= OLED_EMULATOR_TX_BUFFER ? 0 : OLED_EMULATOR_TX_BUFFER - queued;
+}
+
+bool EmulatorSerialContainer::waitForData(uint32_t timeoutUs)
+{
+    if (available())
+        return true;
+    if (_responseCount == 0)
+    {
+        // Nothing is coming.
+        delayMicroseconds(timeoutUs);
+        return false;
+    }
+    int32_t wait = (int32_t)(_responses[_responseHead].readyUs - _now());
+    if (wait > (int32_t)timeoutUs)
+    {
+        delayMicroseconds(timeoutUs);
+        return false;
+    }
+    if (wait > 0)
+        delayMicroseconds(wait);
+    return true;
+}
+
+
+//
+// Settings and inspection
+//
+
+void EmulatorSerialContainer::setTiming(bool enabled) { _timing = enabled; }
+
+void EmulatorSerialContainer::setCommandTime(uint32_t commandUs, uint32_t pixelNs)
+{
+    _commandUs = commandUs;
+    _pixelNs = pixelNs;
+}
+
+void EmulatorSerialContainer::setSDSectorTime(uint32_t sectorUs) { _sdSectorUs = sectorUs; }
+void EmulatorSerialContainer::setBaudLimit(uint32_t baudRate) { _baudLimit = baudRate; }
+
+uint16_t EmulatorSerialContainer::getWidth() { return _width; }
+uint16_t EmulatorSerialContainer::getHeight() { return _height; }
+uint32_t EmulatorSerialContainer::getDeviceBaud() { return _deviceBaud; }
+const uint16_t *EmulatorSerialContainer::getFramebuffer() { return _screen.getBuffer(); }
+
+uint16_t EmulatorSerialContainer::getPixel(uint16_t x, uint16_t y)
+{
+    if (x >= _width || y >= _height)
+        return 0;
+    return _screen.getBuffer()[(uint32_t)y * _width + x];
+}
+
+bool EmulatorSerialContainer::savePPM(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+    fprintf(file, "P6\n%u %u\n255\n", _width, _height);
+    for (uint32_t i = 0; i < (uint32_t)_width * _height; i++)
+    {
+        uint16_t color = _screen.getBuffer()[i];
+        uint8_t rgb[3] = {
+            (uint8_t)((color >> 11) * 255 / 31),
+            (uint8_t)(((color >> 5) & 0x3F) * 255 / 63),
+            (uint8_t)((color & 0x1F) * 255 / 31)
+        };
+        fwrite(rgb, 1, 3, file);
+    }
+    return fclose(file) == 0;
+}
+
+const EmulatorSerialContainer::Stats &EmulatorSerialContainer::getStats() { return _stats; }
+void EmulatorSerialContainer::clearStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+
+//
+// Timing
+//
+
+uint32_t EmulatorSerialContainer::_now() { return micros(); }
+
+// 8N1: 10 bits per byte
+uint32_t EmulatorSerialContainer::_byteUs(uint32_t baudRate)
+{
+    if (baudRate == 0)
+        return 1;
+    return max((uint32_t)1, (uint32_t)(10000000UL / baudRate));
+}
+
+bool EmulatorSerialContainer::_isGarbled(uint32_t baudRate)
+{
+    return baudRate != _hostBaud || (_baudLimit && baudRate > _baudLimit);
+}
+
+// What a byte looks like after being sampled at the wrong rate. Anything but itself will do.
+uint8_t EmulatorSerialContainer::_garble(uint8_t data) { return data ^ 0xA5; }
+
+// Times the command that just finished: it starts once its last byte is in and the display
+// is free, and its responses go out back to back when it's done.
+void EmulatorSerialContainer::_finishCommand()
+{
+    _stats.commands++;
+    uint32_t commandPixels = _screen.getPixelsWritten();
+    _screen.clearPixelsWritten();
+    _stats.pixelsDrawn += commandPixels;
+
+    uint32_t start = _later(_commandArrivedUs, _deviceFreeUs);
+    uint32_t done = start + _commandUs + _commandExtraUs +
+        (uint32_t)((uint64_t)commandPixels * _pixelNs / 1000);
+    _deviceFreeUs = done;
+
+    uint32_t sendUs = _later(done, _txFreeUs);
+    for (uint16_t r = _commandResponses; r < _responseCount; r++)
+    {
+        Response &response = _responses[(_responseHead + r) % OLED_EMULATOR_RESPONSE_BUFFER];
+        sendUs += _byteUs(response.baudRate);
+        response.readyUs = sendUs;
+    }
+    _txFreeUs = sendUs;
+    _commandExtraUs = 0;
+}
+
+void EmulatorSerialContainer::_respond(uint8_t data)
+{
+    if (_silent)
+        return;
+    if (_responseCount >= OLED_EMULATOR_RESPONSE_BUFFER)
+    {
+        _overflow = true;
+        return;
+    }
+    Response &response = _responses[(_responseHead + _responseCount) % OLED_EMULATOR_RESPONSE_BUFFER];
+    response.data = data;
+    response.baudRate = _deviceBaud;
+    response.readyUs = _now();
+    _responseCount++;
+    _stats.bytesSent++;
+}
+
+void EmulatorSerialContainer::_respondAck(bool success)
+{
+    if (!success && !_silent)
+        _stats.naks++;
+    _respond(success ? OLED_ACK : OLED_NAK);
+}
+
+void EmulatorSerialContainer::_respondShort(uint16_t data)
+{
+    _respond(data >> 8);
+    _respond(data & 0xFF);
+}
+
+
+//
+// Parsing
+//
+
+// Total length of the command at the start of the buffer; 0 if more bytes are needed to tell.
+// For OLED_CMD_DRAW_IMAGE this is just the header; the pixels are streamed.
+uint16_t EmulatorSerialContainer::_commandLength(const uint8_t *command, uint16_t length)
+{
+    uint8_t s = _spatialBytes;
+    switch (command[0])
+    {
+    case OLED_CMD_BAUD_AUTO:
+    case OLED_CMD_CLEAR_SCREEN:
+    case OLED_CMD_GET_RESOLUTION:
+        return 1;
+    case OLED_CMD_INFO:
+    case OLED_CMD_BAUD:
+    case OLED_CMD_SET_VOLUME:
+    case OLED_CMD_INPUT_STATUS:
+    case OLED_CMD_SET_SHAPE_FILL:
+    case OLED_CMD_SET_FONT:
+    case OLED_CMD_SET_FONT_OPACITY:
+        return 2;
+    case OLED_CMD_CTLFUNC:
+    case OLED_CMD_SLEEP:
+    case OLED_CMD_SET_BACKGROUND:
+    case OLED_CMD_REPLACE_BACKGROUND:
+        return 3;
+    case OLED_CMD_INPUT_STATUS_WAIT:
+        return 4;
+    case OLED_CMD_SOUND:
+        return 5;
+    case OLED_CMD_TUNE:
+        return length < 2 ? 0 : 2 + 4 * command[1];
+    case OLED_CMD_READ_PIXEL:
+        return 1 + 2*s;
+    case OLED_CMD_DRAW_PIXEL:
+        return 1 + 2*s + 2;
+    case OLED_CMD_DRAW_LINE:
+    case OLED_CMD_DRAW_RECTANGLE:
+        return 1 + 4*s + 2;
+    case OLED_CMD_REPLACE_COLOR:
+        return 1 + 4*s + 4;
+    case OLED_CMD_DRAW_TRIANGLE:
+        return 1 + 6*s + 2;
+    case OLED_CMD_DRAW_POLYGON:
+        return length < 2 ? 0 : 2 + command[1] * 2*s + 2;
+    case OLED_CMD_DRAW_CIRCLE:
+        return 1 + 3*s + 2;
+    case OLED_CMD_DRAW_IMAGE:
+        return 1 + 4*s + 1;
+    case OLED_CMD_ADD_USER_BITMAP:
+        return 10;
+    case OLED_CMD_DRAW_USER_BITMAP:
+        return 2 + 2*s + 2;
+    case OLED_CMD_SCREEN_COPY_PASTE:
+        return 1 + 6*s;
+    case OLED_CMD_DRAW_CHAR_TEXT:
+        return 6;
+    case OLED_CMD_DRAW_CHAR_GFX:
+        return 2 + 2*s + 4;
+    case OLED_CMD_DRAW_STRING_TEXT:
+        return _stringLength(command, length, 6);
+    case OLED_CMD_DRAW_STRING_GFX:
+        return _stringLength(command, length, 1 + 2*s + 5);
+    case OLED_CMD_DRAW_STRING_BUTTON:
+        return _stringLength(command, length, 2 + 2*s + 7);
+    case OLED_CMD_EXTENDED_SD:
+        if (length < 2)
+            return 0;
+        switch (command[1])
+        {
+        case OLED_CMD_SD_INITIALIZE_CARD:
+        case OLED_CMD_SD_READ_BYTE:
+            return 2;
+        case OLED_CMD_SD_WRITE_BYTE:
+            return 3;
+        case OLED_CMD_SD_READ_SECTOR_BLOCK:
+            return 5;
+        case OLED_CMD_SD_WRITE_SECTOR_BLOCK:
+            return 5 + OLED_SD_SECTOR_SIZE;
+        case OLED_CMD_SD_SET_ADDRESS_POINTER:
+        case OLED_CMD_SD_DISPLAY_OBJECT:
+        case OLED_CMD_SD_RUN_4DSL_SCRIPT:
+            return 6;
+        case OLED_CMD_SD_WRITE_SCREENSHOT:
+            return 2 + 4*s + 3;
+        case OLED_CMD_SD_DISPLAY_IMAGE:
+            return 2 + 4*s + 4;
+        case OLED_CMD_SD_DISPLAY_VIDEO:
+            return 2 + 4*s + 7;
+        default:
+            return OLED_EMULATOR_UNKNOWN;
+        }
+    default:
+        return OLED_EMULATOR_UNKNOWN;
+    }
+}
+
+// Length of a command ending in a nul-terminated string after a fixed header
+uint16_t EmulatorSerialContainer::_stringLength(const uint8_t *command, uint16_t length,
+    uint16_t headerLength)
+{
+    for (uint16_t i = headerLength; i < length; i++)
+    {
+        if (command[i] == 0x00)
+            return i + 1;
+    }
+    return 0;
+}
+
+void EmulatorSerialContainer::_receive(uint8_t data)
+{
+    _stats.bytesReceived++;
+    uint32_t arrivedUs = _later(_now(), _rxFreeUs) + _byteUs(_hostBaud);
+    _rxFreeUs = arrivedUs;
+
+    if (!_autoBauded)
+    {
+        // Deaf until it hears the auto-baud byte, at whatever rate that comes in.
+        if (data != OLED_CMD_BAUD_AUTO)
+            return;
+        _autoBauded = true;
+        _deviceBaud = _hostBaud;
+    }
+    else if (_isGarbled(_deviceBaud))
+    {
+        _stats.garbledBytes++;
+        data = _garble(data);
+    }
+
+    if (_commandCount == 0)
+    {
+        _commandResponses = _responseCount;
+        _screen.clearPixelsWritten();
+        _commandExtraUs = 0;
+    }
+    _commandArrivedUs = arrivedUs;
+
+    if (_imagePixelsLeft > 0)
+    {
+        if (_imageBytesPerPixel == 2 && !_imageHaveHighByte)
+        {
+            _imageHighByte = data;
+            _imageHaveHighByte = true;
+            return;
+        }
+        uint16_t color = _imageBytesPerPixel == 2
+            ? ((uint16_t)_imageHighByte << 8) | data
+            : Color::from8BitRGB(data).to16BitRGB();
+        _imageHaveHighByte = false;
+        _screen.drawPixel(_imageX, _imageY, color);
+        if (++_imageX >= _imageLeft + _imageWidth)
+        {
+            _imageX = _imageLeft;
+            _imageY++;
+        }
+        if (--_imagePixelsLeft == 0)
+        {
+            _respondAck(true);
+            _finishCommand();
+        }
+        return;
+    }
+
+    if (_commandCount >= OLED_EMULATOR_COMMAND_BUFFER)
+    {
+        // Runaway string; give up on it.
+        _commandCount = 0;
+        _respondAck(false);
+        _finishCommand();
+        return;
+    }
+    _command[_commandCount++] = data;
+
+    uint16_t length = _commandLength(_command, _commandCount);
+    if (length == OLED_EMULATOR_UNKNOWN)
+    {
+        _commandCount = 0;
+        _respondAck(false);
+        _finishCommand();
+        return;
+    }
+    if (length == 0 || _commandCount < length)
+        return;
+
+    _commandCount = 0;
+    _execute(_command);
+    // Image commands finish when their last pixel arrives.
+    if (_imagePixelsLeft == 0)
+        _finishCommand();
+}
+
+
+//
+// Commands
+//
+
+uint16_t EmulatorSerialContainer::_readSpatial(const uint8_t *&data)
+{
+    uint16_t value = *data++;
+    if (_spatialBytes == 2)
+        value = (value << 8) | *data++;
+    return value;
+}
+
+uint16_t EmulatorSerialContainer::_readShort(const uint8_t *&data)
+{
+    uint16_t value = ((uint16_t)data[0] << 8) | data[1];
+    data += 2;
+    return value;
+}
+
+uint32_t EmulatorSerialContainer::_readSector(const uint8_t *&data)
+{
+    uint32_t value = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+    data += 3;
+    return value;
+}
+
+void EmulatorSerialContainer::_execute(const uint8_t *command)
+{
+    const uint8_t *p = command + 1;
+    switch (command[0])
+    {
+    case OLED_CMD_BAUD_AUTO:
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_INFO:
+        _respond(_spatialBytes == 2 ? OLED_DEVICETYPE_LCD : OLED_DEVICETYPE_OLED);
+        _respond(0x01);
+        _respond(0x10);
+        _respond(_getResolutionCode(_width));
+        _respond(_getResolutionCode(_height));
+        break;
+
+    case OLED_CMD_GET_RESOLUTION:
+        _respondShort(_width);
+        _respondShort(_height);
+        break;
+
+    case OLED_CMD_BAUD:
+        if (command[1] >= sizeof(_baudRates) / sizeof(_baudRates[0]))
+        {
+            _respondAck(false);
+            break;
+        }
+        // The ACK goes out at the new rate.
+        _deviceBaud = _baudRates[command[1]];
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_CLEAR_SCREEN:
+        _screen.clear(_background);
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_CTLFUNC:
+    case OLED_CMD_SLEEP:
+    case OLED_CMD_SET_VOLUME:
+    case OLED_CMD_SOUND:
+    case OLED_CMD_TUNE:
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_INPUT_STATUS:
+    case OLED_CMD_INPUT_STATUS_WAIT:
+        // No joystick: nothing pressed
+        _respond(0x00);
+        break;
+
+    case OLED_CMD_READ_PIXEL:
+    {
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        _respondShort(getPixel(x, y));
+        break;
+    }
+
+    case OLED_CMD_DRAW_PIXEL:
+    {
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        _screen.drawPixel(x, y, _readShort(p));
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_LINE:
+    case OLED_CMD_DRAW_RECTANGLE:
+    {
+        uint16_t x1 = _readSpatial(p);
+        uint16_t y1 = _readSpatial(p);
+        uint16_t x2 = _readSpatial(p);
+        uint16_t y2 = _readSpatial(p);
+        uint16_t color = _readShort(p);
+        if (command[0] == OLED_CMD_DRAW_LINE)
+            _screen.drawLine(x1, y1, x2, y2, color);
+        else
+            _screen.drawRectangle(x1, y1, x2, y2, color, _fill);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_REPLACE_COLOR:
+    {
+        uint16_t x1 = _readSpatial(p);
+        uint16_t y1 = _readSpatial(p);
+        uint16_t x2 = _readSpatial(p);
+        uint16_t y2 = _readSpatial(p);
+        uint16_t oldColor = _readShort(p);
+        uint16_t newColor = _readShort(p);
+        _screen.replaceColor(x1, y1, x2, y2, oldColor, newColor);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_TRIANGLE:
+    {
+        uint16_t x1 = _readSpatial(p);
+        uint16_t y1 = _readSpatial(p);
+        uint16_t x2 = _readSpatial(p);
+        uint16_t y2 = _readSpatial(p);
+        uint16_t x3 = _readSpatial(p);
+        uint16_t y3 = _readSpatial(p);
+        uint16_t color = _readShort(p);
+        _screen.drawTriangle(x1, y1, x2, y2, x3, y3, color, _fill);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_POLYGON:
+    {
+        // Always an outline
+        uint8_t vertices = *p++;
+        const uint8_t *colorData = p + vertices * 2 * _spatialBytes;
+        uint16_t color = _readShort(colorData);
+        uint16_t x0 = _readSpatial(p);
+        uint16_t y0 = _readSpatial(p);
+        uint16_t lastX = x0, lastY = y0;
+        for (uint8_t v = 1; v < vertices; v++)
+        {
+            uint16_t x = _readSpatial(p);
+            uint16_t y = _readSpatial(p);
+            _screen.drawLine(lastX, lastY, x, y, color);
+            lastX = x;
+            lastY = y;
+        }
+        _screen.drawLine(lastX, lastY, x0, y0, color);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_CIRCLE:
+    {
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        uint16_t radius = _readSpatial(p);
+        _screen.drawCircle(x, y, radius, _readShort(p), _fill);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_IMAGE:
+    {
+        _imageLeft = _imageX = _readSpatial(p);
+        _imageY = _readSpatial(p);
+        _imageWidth = _readSpatial(p);
+        uint16_t imageHeight = _readSpatial(p);
+        uint8_t mode = *p++;
+        _imagePixelsLeft = (uint32_t)_imageWidth * imageHeight;
+        _imageBytesPerPixel = mode == OLED_PRM_DRAW_IMAGE_16BIT ? 2 : 1;
+        _imageHaveHighByte = false;
+        if (_imagePixelsLeft == 0)
+            _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_ADD_USER_BITMAP:
+        memcpy(_userBitmaps[command[1] % OLED_MAX_USER_BITMAPS], command + 2, 8);
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_DRAW_USER_BITMAP:
+    {
+        const uint8_t *bitmap = _userBitmaps[*p++ % OLED_MAX_USER_BITMAPS];
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        uint16_t color = _readShort(p);
+        for (uint8_t row = 0; row < 8; row++)
+            for (uint8_t col = 0; col < 8; col++)
+                if (bitmap[row] & (0x80 >> col))
+                    _screen.drawPixel(x + col, y + row, color);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_SET_BACKGROUND:
+        _background = _readShort(p);
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_REPLACE_BACKGROUND:
+    {
+        uint16_t color = _readShort(p);
+        _screen.replaceColor(0, 0, _width - 1, _height - 1, _background, color);
+        _background = color;
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_SET_SHAPE_FILL:
+        _fill = command[1] == OLED_PRM_SHAPE_FILL_SOLID;
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_SCREEN_COPY_PASTE:
+    {
+        uint16_t sourceX = _readSpatial(p);
+        uint16_t sourceY = _readSpatial(p);
+        uint16_t destX = _readSpatial(p);
+        uint16_t destY = _readSpatial(p);
+        uint16_t width = _readSpatial(p);
+        uint16_t height = _readSpatial(p);
+        _screen.copyPaste(sourceX, sourceY, destX, destY, width, height);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_SET_FONT:
+        if (command[1] > (_spatialBytes == 2 ? OLED_FONT_EXTRA_LARGE : OLED_FONT_LARGE))
+        {
+            _respondAck(false);
+            break;
+        }
+        _font = command[1];
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_SET_FONT_OPACITY:
+        _fontOpaque = command[1] == OLED_FONT_OPAQUE;
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_DRAW_CHAR_TEXT:
+    {
+        char c = *p++;
+        uint8_t col = *p++;
+        uint8_t row = *p++;
+        uint8_t cellWidth, cellHeight;
+        _getCellSize(_font, cellWidth, cellHeight);
+        _drawChar(col * cellWidth, row * cellHeight, c, _font, _readShort(p), 1, 1, _fontOpaque);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_CHAR_GFX:
+    {
+        char c = *p++;
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        uint16_t color = _readShort(p);
+        uint8_t scaleX = *p++;
+        uint8_t scaleY = *p++;
+        _drawChar(x, y, c, _font, color, scaleX, scaleY, _fontOpaque);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_STRING_TEXT:
+    {
+        uint8_t col = *p++;
+        uint8_t row = *p++;
+        uint8_t font = *p++ & 0x0F;
+        uint16_t color = _readShort(p);
+        uint8_t cellWidth, cellHeight;
+        _getCellSize(font, cellWidth, cellHeight);
+        _drawString(col * cellWidth, row * cellHeight, (const char *)p, font, color,
+            1, 1, _fontOpaque);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_STRING_GFX:
+    {
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        uint8_t font = *p++ & 0x0F;
+        uint16_t color = _readShort(p);
+        uint8_t scaleX = *p++;
+        uint8_t scaleY = *p++;
+        _drawString(x, y, (const char *)p, font, color, scaleX, scaleY, _fontOpaque);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_DRAW_STRING_BUTTON:
+    {
+        bool pressed = *p++ == OLED_PRM_BUTTON_DOWN;
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        uint16_t buttonColor = _readShort(p);
+        uint8_t font = *p++ & 0x0F;
+        uint16_t fontColor = _readShort(p);
+        uint8_t scaleX = *p++;
+        uint8_t scaleY = *p++;
+        const char *text = (const char *)p;
+        uint8_t cellWidth, cellHeight;
+        _getCellSize(font, cellWidth, cellHeight);
+        // Text with a 2 pixel border; pressed buttons shift their text down and right.
+        _screen.drawRectangle(x, y, x + strlen(text) * cellWidth * scaleX + 3,
+            y + cellHeight * scaleY + 3, buttonColor, true);
+        uint8_t offset = pressed ? 3 : 2;
+        _drawString(x + offset, y + offset, text, font, fontColor, scaleX, scaleY, _fontOpaque);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_EXTENDED_SD:
+        _executeSD(command);
+        break;
+
+    default:
+        _respondAck(false);
+        break;
+    }
+}
+
+void EmulatorSerialContainer::_executeSD(const uint8_t *command)
+{
+    const uint8_t *p = command + 2;
+    if (!_sdImage)
+    {
+        _respondAck(false);
+        return;
+    }
+
+    switch (command[1])
+    {
+    case OLED_CMD_SD_INITIALIZE_CARD:
+        _sdInitialized = true;
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_SD_SET_ADDRESS_POINTER:
+        _sdAddress = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+            ((uint32_t)p[2] << 8) | p[3];
+        _respondAck(true);
+        break;
+
+    case OLED_CMD_SD_READ_BYTE:
+    {
+        uint8_t data;
+        _sdAccess(_sdAddress++, &data, 1, false);
+        _respond(data);
+        break;
+    }
+
+    case OLED_CMD_SD_WRITE_BYTE:
+    {
+        uint8_t data = *p;
+        _respondAck(_sdAccess(_sdAddress++, &data, 1, true));
+        break;
+    }
+
+    case OLED_CMD_SD_READ_SECTOR_BLOCK:
+    {
+        uint8_t sector[OLED_SD_SECTOR_SIZE];
+        _sdAccess(_readSector(p) * OLED_SD_SECTOR_SIZE, sector, OLED_SD_SECTOR_SIZE, false);
+        for (uint16_t b = 0; b < OLED_SD_SECTOR_SIZE; b++)
+            _respond(sector[b]);
+        _commandExtraUs += _sdSectorUs;
+        break;
+    }
+
+    case OLED_CMD_SD_WRITE_SECTOR_BLOCK:
+    {
+        uint32_t address = _readSector(p) * OLED_SD_SECTOR_SIZE;
+        _respondAck(_sdAccess(address, (uint8_t *)p, OLED_SD_SECTOR_SIZE, true));
+        _commandExtraUs += _sdSectorUs;
+        break;
+    }
+
+    case OLED_CMD_SD_WRITE_SCREENSHOT:
+    {
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        uint16_t width = _readSpatial(p);
+        uint16_t height = _readSpatial(p);
+        uint32_t address = _readSector(p) * OLED_SD_SECTOR_SIZE;
+        bool ok = true;
+        for (uint16_t row = 0; row < height && ok; row++)
+        {
+            for (uint16_t col = 0; col < width && ok; col++)
+            {
+                uint16_t color = getPixel(x + col, y + row);
+                uint8_t data[2] = { (uint8_t)(color >> 8), (uint8_t)(color & 0xFF) };
+                ok = _sdAccess(address, data, 2, true);
+                address += 2;
+            }
+        }
+        _commandExtraUs += ((uint32_t)width * height * 2 / OLED_SD_SECTOR_SIZE + 1) * _sdSectorUs;
+        _respondAck(ok);
+        break;
+    }
+
+    case OLED_CMD_SD_DISPLAY_IMAGE:
+    case OLED_CMD_SD_DISPLAY_VIDEO:
+    {
+        uint16_t x = _readSpatial(p);
+        uint16_t y = _readSpatial(p);
+        uint16_t width = _readSpatial(p);
+        uint16_t height = _readSpatial(p);
+        uint8_t bytesPerPixel = *p++ == OLED_PRM_DRAW_IMAGE_16BIT ? 2 : 1;
+        uint8_t frameDelayMs = 0;
+        uint16_t frames = 1;
+        if (command[1] == OLED_CMD_SD_DISPLAY_VIDEO)
+        {
+            frameDelayMs = *p++;
+            frames = _readShort(p);
+        }
+        uint32_t address = _readSector(p) * OLED_SD_SECTOR_SIZE;
+        uint32_t frameBytes = (uint32_t)width * height * bytesPerPixel;
+        // Frames start on sector boundaries.
+        uint32_t frameSectors = (frameBytes + OLED_SD_SECTOR_SIZE - 1) / OLED_SD_SECTOR_SIZE;
+        uint8_t data[2];
+        for (uint16_t frame = 0; frame < frames; frame++)
+        {
+            uint32_t pixelAddress = address + frame * frameSectors * OLED_SD_SECTOR_SIZE;
+            for (uint16_t row = 0; row < height; row++)
+            {
+                for (uint16_t col = 0; col < width; col++)
+                {
+                    _sdAccess(pixelAddress, data, bytesPerPixel, false);
+                    pixelAddress += bytesPerPixel;
+                    _screen.drawPixel(x + col, y + row, bytesPerPixel == 2
+                        ? ((uint16_t)data[0] << 8) | data[1]
+                        : Color::from8BitRGB(data[0]).to16BitRGB());
+                }
+            }
+        }
+        _commandExtraUs += frames * (frameSectors * _sdSectorUs + frameDelayMs * 1000UL);
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_SD_DISPLAY_OBJECT:
+    {
+        // Runs a single command stored on the card. Its own response is swallowed.
+        uint32_t address = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+            ((uint32_t)p[2] << 8) | p[3];
+        uint8_t object[OLED_EMULATOR_COMMAND_BUFFER];
+        uint16_t objectLength = 0;
+        uint16_t needed = 0;
+        while (objectLength < OLED_EMULATOR_COMMAND_BUFFER &&
+            _sdAccess(address + objectLength, object + objectLength, 1, false))
+        {
+            objectLength++;
+            needed = _commandLength(object, objectLength);
+            if (needed != 0)
+                break;
+        }
+        if (needed == 0 || needed == OLED_EMULATOR_UNKNOWN || needed > OLED_EMULATOR_COMMAND_BUFFER ||
+            object[0] == OLED_CMD_DRAW_IMAGE || object[0] == OLED_CMD_EXTENDED_SD ||
+            !_sdAccess(address, object, needed, false))
+        {
+            _respondAck(false);
+            break;
+        }
+        _silent = true;
+        _execute(object);
+        _silent = false;
+        _commandExtraUs += _sdSectorUs;
+        _respondAck(true);
+        break;
+    }
+
+    case OLED_CMD_SD_RUN_4DSL_SCRIPT:
+    default:
+        // Scripts aren't emulated.
+        _respondAck(false);
+        break;
+    }
+}
+
+// Reads past the end of the image come back as zeros, like an erased card.
+bool EmulatorSerialContainer::_sdAccess(uint32_t byteAddress, uint8_t *data, uint32_t length,
+    bool writing)
+{
+    if (fseek(_sdImage, byteAddress, SEEK_SET) != 0)
+        return false;
+    if (writing)
+        return fwrite(data, 1, length, _sdImage) == length;
+    size_t got = fread(data, 1, length, _sdImage);
+    memset(data + got, 0, length - got);
+    return true;
+}
+
+
+//
+// Drawing
+//
+
+void EmulatorSerialContainer::_getCellSize(uint8_t font, uint8_t &width, uint8_t &height)
+{
+    switch (font)
+    {
+    case OLED_FONT_MEDIUM: width = 8; height = 8; break;
+    case OLED_FONT_LARGE: width = 8; height = 12; break;
+    case OLED_FONT_EXTRA_LARGE: width = 12; height = 16; break;
+    case OLED_FONT_SMALL:
+    default: width = 6; height = 8; break;
+    }
+}
+
+void EmulatorSerialContainer::_drawChar(int32_t x, int32_t y, char c, uint8_t font,
+    uint16_t color, uint8_t scaleX, uint8_t scaleY, bool opaque)
+{
+    uint8_t cellWidth, cellHeight;
+    _getCellSize(font, cellWidth, cellHeight);
+    scaleX = max(scaleX, (uint8_t)1);
+    scaleY = max(scaleY, (uint8_t)1);
+    if (opaque)
+        _screen.drawRectangle(x, y, x + cellWidth * scaleX - 1, y + cellHeight * scaleY - 1,
+            _background, true);
+    if (c < 0x20 || c > 0x7E)
+        return;
+
+    const uint8_t *glyph = _font5x7[c - 0x20];
+    for (uint8_t col = 0; col < 5; col++)
+        for (uint8_t row = 0; row < 8; row++)
+            if (glyph[col] & (1 << row))
+                _screen.drawRectangle(x + col * scaleX, y + row * scaleY,
+                    x + (col + 1) * scaleX - 1, y + (row + 1) * scaleY - 1, color, true);
+}
+
+void EmulatorSerialContainer::_drawString(int32_t x, int32_t y, const char *text, uint8_t font,
+    uint16_t color, uint8_t scaleX, uint8_t scaleY, bool opaque)
+{
+    uint8_t cellWidth, cellHeight;
+    _getCellSize(font, cellWidth, cellHeight);
+    for (; *text; text++, x += cellWidth * max(scaleX, (uint8_t)1))
+        _drawChar(x, y, *text, font, color, scaleX, scaleY, opaque);
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef EmulatorSerialContainer_h
+#define EmulatorSerialContainer_h
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <stdio.h>
+
+#include "OLEDShadow.h"
+#include "SerialContainers.h"
+
+#define OLED_EMULATOR_COMMAND_BUFFER    1024    // Longest command (other than image data) accepted
+#define OLED_EMULATOR_RESPONSE_BUFFER   1024    // Response bytes waiting to be read
+#define OLED_EMULATOR_TX_BUFFER         64      // Bytes write() queues before blocking, like HardwareSerial
+#define OLED_EMULATOR_COMMAND_US        50      // Default time to execute any command
+#define OLED_EMULATOR_PIXEL_NS          100     // Default time to draw each pixel
+#define OLED_EMULATOR_SD_SECTOR_US      1000    // Default time to read or write an SD sector
+
+// A GOLDELOX/PICASO display in software, for running the library on a host without hardware.
+// Commands written to it are parsed and drawn into an RGB565 framebuffer; the extended SD
+// commands work against an image file. Responses become readable only once the command
+// would have finished on a real display: bytes take 10 bits each at the current baud rate
+// in both directions, and each command takes a fixed time plus a time per pixel drawn.
+//
+// Like the real thing it ignores everything until it is reset and auto-bauded. Have the
+// reset pin call reset(), e.g. from a setPinWriteHook() hook.
+//
+// Text is drawn with a 5x7 font in every size, so it only approximates the real glyphs.
+class EmulatorSerialContainer : public SerialContainer
+{
+public:
+    struct Stats
+    {
+        uint32_t commands;
+        uint32_t naks;
+        uint32_t bytesReceived;     // From the host
+        uint32_t bytesSent;         // To the host
+        uint32_t pixelsDrawn;
+        uint32_t garbledBytes;      // Bytes sent or received at a mismatched/unreliable baud rate
+    };
+
+    // The controller is a Picaso if either side is over 255 pixels, a Goldelox otherwise.
+    // Without an SD image, the SD commands NAK as if no card was inserted.
+    EmulatorSerialContainer(uint16_t width, uint16_t height, const char *sdImagePath = 0);
+    ~EmulatorSerialContainer();
+
+    void begin(uint32_t baudRate);
+    void end();
+    int available();
+    int peek();
+    int read();
+    void flush();
+    bool overflow();
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *buffer, size_t size);
+    int availableForWrite();
+    bool waitForData(uint32_t timeoutUs);
+
+    // Power-on state: black screen, waiting for auto-baud, anything in flight dropped.
+    void reset();
+
+    // Timing off makes every response available immediately.
+    void setTiming(bool enabled);
+    void setCommandTime(uint32_t commandUs, uint32_t pixelNs);
+    void setSDSectorTime(uint32_t sectorUs);
+    // Rates above this garble every byte, so baud negotiation has something to find. 0 = no limit.
+    void setBaudLimit(uint32_t baudRate);
+
+    uint16_t getWidth();
+    uint16_t getHeight();
+    uint32_t getDeviceBaud();
+    const uint16_t *getFramebuffer();
+    uint16_t getPixel(uint16_t x, uint16_t y);
+    // Writes the screen as a binary PPM.
+    bool savePPM(const char *path);
+
+    const Stats &getStats();
+    void clearStats();
+
+private:
+    struct Response
+    {
+        uint8_t data;
+        uint32_t baudRate;  // Rate it was sent at; reading it at any other rate garbles it
+        uint32_t readyUs;
+    };
+
+    uint16_t _commandLength(const uint8_t *command, uint16_t length);
+    uint16_t _stringLength(const uint8_t *command, uint16_t length, uint16_t headerLength);
+    void _receive(uint8_t data);
+    void _execute(const uint8_t *command);
+    void _executeSD(const uint8_t *command);
+    void _finishCommand();
+    void _respond(uint8_t data);
+    void _respondAck(bool success);
+    void _respondShort(uint16_t data);
+    uint16_t _readSpatial(const uint8_t *&data);
+    uint16_t _readShort(const uint8_t *&data);
+    uint32_t _readSector(const uint8_t *&data);
+
+    void _drawChar(int32_t x, int32_t y, char c, uint8_t font, uint16_t color,
+        uint8_t scaleX, uint8_t scaleY, bool opaque);
+    void _drawString(int32_t x, int32_t y, const char *text, uint8_t font, uint16_t color,
+        uint8_t scaleX, uint8_t scaleY, bool opaque);
+    static void _getCellSize(uint8_t font, uint8_t &width, uint8_t &height);
+
+    bool _sdAccess(uint32_t byteAddress, uint8_t *data, uint32_t length, bool writing);
+    uint32_t _now();
+    uint32_t _byteUs(uint32_t baudRate);
+    bool _isGarbled(uint32_t baudRate);
+    static uint8_t _garble(uint8_t data);
+
+    uint16_t _width;
+    uint16_t _height;
+    uint8_t _spatialBytes;
+    OLEDShadow _screen;     // The framebuffer, drawn the same way OLED draws its shadow
+    FILE *_sdImage;
+
+    // Device state
+    bool _autoBauded;
+    uint32_t _deviceBaud;
+    uint32_t _hostBaud;
+    uint32_t _baudLimit;
+    uint16_t _background;
+    bool _fill;
+    uint8_t _font;
+    bool _fontOpaque;
+    uint8_t _userBitmaps[32][8];
+    uint32_t _sdAddress;
+    bool _sdInitialized;
+
+    // Incoming command; image data is drawn as it arrives rather than buffered
+    uint8_t _command[OLED_EMULATOR_COMMAND_BUFFER];
+    uint16_t _commandCount;
+    uint32_t _imagePixelsLeft;
+    uint8_t _imageBytesPerPixel;
+    uint8_t _imageHighByte;
+    bool _imageHaveHighByte;
+    int32_t _imageX, _imageY, _imageLeft, _imageWidth;
+
+    Response _responses[OLED_EMULATOR_RESPONSE_BUFFER];
+    uint16_t _responseHead;
+    uint16_t _responseCount;
+    bool _overflow;
+
+    // Timing: when the host-to-display line, the display, and the display-to-host line are next free
+    bool _timing;
+    uint32_t _commandUs;
+    uint32_t _pixelNs;
+    uint32_t _sdSectorUs;
+    uint32_t _rxFreeUs;
+    uint32_t _deviceFreeUs;
+    uint32_t _txFreeUs;
+    uint32_t _commandArrivedUs;
+    uint32_t _commandExtraUs;
+    uint16_t _commandResponses;
+    bool _silent;
+
+    Stats _stats;
+};
+
+#endif
+
+#endif
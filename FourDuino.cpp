@@ -1,29 +1,109 @@
 #include "FourDuino.h"
+#include "OLEDCommands.h"
 
+// Telemetry hooks disappear entirely when OLED_TELEMETRY is off. Either way they're one
+// statement, so they can be the body of an if.
+#if OLED_TELEMETRY
+#define OLED_TELEMETRY_RECORD(event) do { _telemetry.event; } while (0)
+#else
+#define OLED_TELEMETRY_RECORD(event) do {} while (0)
+#endif
+
+// Rates init(true) steps through, slowest first.
+static const uint32_t _baudSteps[] PROGMEM = {
+    9600, 14400, 19200, 31250, 38400, 56000, 57600, 115200, 128000, 129032, 256000, 282353 };
+#define OLED_BAUD_STEP_COUNT (sizeof(_baudSteps) / sizeof(_baudSteps[0]))
+
+// Shape coordinates are int16_t passed through uint16_t parameters.
+static int32_t _signed(uint16_t value) { return (int16_t)value; }
+
+// from + (to - from) * part / whole, to the nearest whole pixel
+static int32_t _interpolate(int32_t from, int32_t to, int32_t part, int32_t whole)
+{
+    float offset = (float)(to - from) * part / whole;
+    return from + (int32_t)(offset + (offset < 0 ? -0.5f : 0.5f));
+}
 
 OLED::OLED(uint8_t pinReset, HardwareSerial serial, uint32_t baudRate, uint16_t initDelay)
 {
-    _pinReset = pinReset;
-    _baudRate = baudRate;
-    _initDelay = initDelay;
+    _initFields(pinReset, baudRate, initDelay);
     _serial = new HardwareSerialContainer(serial);
+    _ownsSerial = true;
 }
 
 OLED::OLED(uint8_t pinReset, SoftwareSerial serial, uint32_t baudRate, uint16_t initDelay)
+{
+    _initFields(pinReset, baudRate, initDelay);
+    _serial = new SoftwareSerialContainer(serial);
+    _ownsSerial = true;
+}
+
+OLED::OLED(uint8_t pinReset, SerialContainer *serial, uint32_t baudRate, uint16_t initDelay)
+{
+    _initFields(pinReset, baudRate, initDelay);
+    _serial = serial;
+    _ownsSerial = false;
+}
+
+void OLED::_initFields(uint8_t pinReset, uint32_t baudRate, uint16_t initDelay)
 {
     _pinReset = pinReset;
     _baudRate = baudRate;
     _initDelay = initDelay;
-    _serial = new SoftwareSerialContainer(serial);
+    _frameLength = 0;
+    _serialBaud = 0;
+    _baudNegotiated = false;
+    _baudNegotiating = false;
+    _linkFailures = 0;
+    _linkReset = false;
+    _commandLength = 0;
+    _commandPixels = 0;
+    _deviceWidth = 0;
+    _deviceHeight = 0;
+    resetResponseTimeouts();
+    _pipelineDepth = OLED_PIPELINE_DEPTH_DEFAULT;
+    _pendingAcks = 0;
+    _pendingTimeoutUs = 0;
+    _ackCount = 0;
+    _pipelineErrors = 0;
+    _async = false;
+    _asyncBytes = 0;
+    _asyncCommands = 0;
+    _asyncNextHandle = 0;
+    _asyncCallback = 0;
+    _clearQueue();
+    _fillShapes = true;
+    _background = 0x0000;
+    _deviceFontOpacity = false;
+    _stateKnown = 0;
+    clearClipRect();
+    _inFrame = false;
+    _originX = 0;
+    _originY = 0;
+    clearBackBuffer();
+    _shadow = 0;
+    _shadowVerifyInterval = 0;
+    _shadowReads = 0;
+    _shadowMismatches = 0;
+    _unconfirmedX1 = 1;
+    _unconfirmedX2 = 0;
+    _pixelBatch = 0;
+    _pixelBatchCount = 0;
+    _batchingPixels = false;
+    _unconfirmedBitmaps = 0;
 }
 
 OLED::~OLED()
 {
-    delete _serial;
+    delete[] _asyncBytes;
+    delete[] _asyncCommands;
+    delete[] _pixelBatch;
+    if (_ownsSerial)
+        delete _serial;
     _serial = 0;
 }
 
-bool OLED::init()
+bool OLED::init(bool negotiateBaud, uint32_t maxBaudRate)
 {
     _deviceType = Unknown;
     _hardwareRevision = 0;
@@ -40,27 +120,65 @@ bool OLED::init()
 
     pinMode(_pinReset, OUTPUT);
 
+    _baudNegotiated = false;
+    _linkFailures = 0;
+    // Negotiation starts from the bottom of the table and works up.
+    if (!_connect(negotiateBaud ? pgm_read_dword(&_baudSteps[0]) : _baudRate))
+        return false;
+
+    getDeviceInfo(false);
+    // The screen-sized estimates depend on the resolution we just found out.
+    resetResponseTimeouts();
+
+    if (negotiateBaud)
+        _negotiateBaud(maxBaudRate);
+
+    _applyDefaults();
+    return true;
+}
+
+// Resets the display and brings it up at the given baud rate.
+bool OLED::_connect(uint32_t baudRate)
+{
+    // Anything still in flight is lost when the display resets.
+    _frameLength = 0;
+    _commandLength = 0;
+    _pendingAcks = 0;
+    _pendingTimeoutUs = 0;
+    _clearQueue();
+    OLED_TELEMETRY_RECORD(clearInFlight());
+    // Power-on state
+    _fillShapes = true;
+    _background = 0x0000;
+    if (_shadow)
+        _shadow->clear(0x0000);
+    _resolveShadow(true);
+    for (uint8_t i = 0; i < OLED_MAX_USER_BITMAPS; i++)
+        _charIndexList[i] = false;
+    _unconfirmedBitmaps = 0;
+
     // Initialize the display using auto-baud command at 9600 baud.
-    bool _run = false;
-    for (uint8_t r = 0; r < OLED_INIT_RETRIES && !_run; r++)
+    for (uint8_t r = 0; r < OLED_INIT_RETRIES; r++)
     {
         reset();
         // Wait for the OLED/SD to initialize
         delay(OLED_INIT_DELAY_MS);
 
         _serial->begin(9600);
+        _serialBaud = 9600;
         // Let the OLED auto-detect baud rate
-        write(OLED_CMD_BAUD_AUTO);
-        if (!getAck())
+        OLEDCommands::autoBaud(*this);
+        if (!_waitForAck())
             continue;
         // Change to the desired baud
-        _run = setBaud(_baudRate);
+        if (setBaud(baudRate))
+            return true;
     }
-    if (!_run)
-        return false;
-
-    getDeviceInfo(false);
+    return false;
+}
 
+void OLED::_applyDefaults()
+{
     setFill(OLED_SHAPE_FILL_DEFAULT);
     setFont(OLED_FONT_SIZE_DEFAULT);
     setFontOpacity(OLED_FONT_OPACITY_DEFAULT);
@@ -69,22 +187,163 @@ bool OLED::init()
     setButtonOpacity(OLED_BUTTON_OPACITY_DEFAULT);
     setButtonColor(OLED_BUTTON_COLOR_DEFAULT);
     setButtonFontColor(OLED_BUTTON_FONT_COLOR_DEFAULT);
-    return true;
 }
 
 bool OLED::setBaud(uint32_t baudRate)
 {
     uint8_t baudByte = 0;
-    if (!_getBaudByte(baudRate, baudByte))
+    if (!getBaudByte(baudRate, baudByte) || !_serial->supportsBaud(baudRate))
         return false;
-    write(OLED_CMD_BAUD);
-    write(baudByte);
-    _serial->begin(_baudRate);
+    // Outstanding ACKs would arrive at the old baud rate.
+    drainPipeline();
+    OLEDCommands::baud(*this, baudByte);
+    _writeFrame();
+    _serial->begin(baudRate);
+    _serialBaud = baudRate;
 
-    return getAck();
+    return _waitForAck();
+}
+
+uint32_t OLED::getBaud() { return _serialBaud; }
+
+
+//
+// Baud negotiation
+//
+
+bool OLED::_negotiateBaud(uint32_t maxBaudRate)
+{
+    _baudNegotiating = true;
+
+    // If the card can be read at the starting rate, every faster rate has to read it identically.
+    uint16_t sectorChecksum = 0;
+    bool checkSD = SDInitialize() &&
+        _readSectorChecksum(OLED_BAUD_VERIFY_SECTOR, sectorChecksum);
+
+    uint32_t goodBaud = _serialBaud;
+    for (uint8_t i = 0; i < OLED_BAUD_STEP_COUNT; i++)
+    {
+        uint32_t baudRate = pgm_read_dword(&_baudSteps[i]);
+        if (baudRate <= goodBaud)
+            continue;
+        if (baudRate > maxBaudRate)
+            break;
+        // Not a failure: the next rate may well work.
+        if (!_serial->supportsBaud(baudRate))
+            continue;
+
+        if (!setBaud(baudRate) || !_verifyBaud(checkSD, sectorChecksum))
+        {
+            // Faster rates aren't going to do any better; go back to the last one that worked.
+            if (!setBaud(goodBaud) || !_verifyBaud(false, 0))
+                _connect(goodBaud);
+            break;
+        }
+        goodBaud = baudRate;
+    }
+
+    _baudNegotiating = false;
+    _baudNegotiated = true;
+    _linkFailures = 0;
+    return _serialBaud == goodBaud;
+}
+
+bool OLED::_verifyBaud(bool checkSD, uint16_t sectorChecksum)
+{
+    DeviceType deviceType = _deviceType;
+    uint16_t width = _deviceWidth;
+    uint16_t height = _deviceHeight;
+
+    for (uint8_t pass = 0; pass < OLED_BAUD_VERIFY_PASSES; pass++)
+    {
+        if (!getDeviceInfo(false) ||
+            _deviceType != deviceType ||
+            _deviceWidth != width ||
+            _deviceHeight != height)
+            return false;
+
+        uint16_t checksum;
+        if (checkSD &&
+            (!_readSectorChecksum(OLED_BAUD_VERIFY_SECTOR, checksum) || checksum != sectorChecksum))
+            return false;
+    }
+    return true;
+}
+
+// Reads a sector without needing a 512 byte buffer for it.
+bool OLED::_readSectorChecksum(uint32_t sectorAddress, uint16_t &checksum)
+{
+    write(5, OLED_CMD_EXTENDED_SD, OLED_CMD_SD_READ_SECTOR_BLOCK,
+        OLEDUtil::getByte(sectorAddress, 2),
+        OLEDUtil::getByte(sectorAddress, 1),
+        OLEDUtil::getByte(sectorAddress));
+
+    checksum = 0;
+    for (uint16_t b = 0; b < OLED_SD_SECTOR_SIZE; b++)
+    {
+        uint8_t result;
+        if (!getResponse(result))
+            return false;
+        // Rotate so swapped bytes don't cancel out.
+        checksum = ((checksum << 1) | (checksum >> 15)) ^ result;
+    }
+    return true;
+}
+
+// Counts consecutive timeouts and garbled responses once a rate has been negotiated.
+// A NAK arrived intact, so it says nothing against the rate. The step down itself waits
+// for the next command to start (see write()), well away from any ACK being collected.
+void OLED::_noteLinkResult(bool received, uint8_t response)
+{
+    if (received && (response == OLED_ACK || response == OLED_NAK))
+    {
+        _linkFailures = 0;
+        return;
+    }
+    if (!_baudNegotiated || _baudNegotiating)
+        return;
+    if (_linkFailures < OLED_BAUD_FALLBACK_ERRORS)
+        _linkFailures++;
+}
+
+bool OLED::wasLinkReset()
+{
+    bool linkReset = _linkReset;
+    _linkReset = false;
+    return linkReset;
+}
+
+// Tries to switch down over the existing link first. If the display can't hear us
+// anymore it has to be reset, which clears the screen; the settings are sent again.
+bool OLED::_stepDownBaud()
+{
+    uint32_t lowerBaud = 0;
+    for (uint8_t i = 0; i < OLED_BAUD_STEP_COUNT; i++)
+    {
+        uint32_t baudRate = pgm_read_dword(&_baudSteps[i]);
+        if (baudRate >= _serialBaud)
+            break;
+        lowerBaud = baudRate;
+    }
+    _linkFailures = 0;
+    if (lowerBaud == 0)
+        return false;
+
+    _baudNegotiating = true;
+    bool result = setBaud(lowerBaud) && _verifyBaud(false, 0);
+    if (!result)
+    {
+        bool fillShapes = _fillShapes;
+        uint16_t background = _background;
+        _linkReset = true;
+        result = _connect(lowerBaud) &&
+            setFill(fillShapes) && setFont(_fontSize) && setBackground(background);
+    }
+    _baudNegotiating = false;
+    return result;
 }
 
-bool OLED::_getBaudByte(uint32_t baudRate, uint8_t &baudByte)
+bool OLED::getBaudByte(uint32_t baudRate, uint8_t &baudByte)
 {
     baudByte = 0xFF;
     switch (baudRate)
@@ -155,6 +414,19 @@ void OLED::reset()
     delay(OLED_RESET_DELAY_MS);
     digitalWrite(_pinReset, HIGH);
     delay(OLED_RESET_DELAY_MS);
+    invalidateState();
+}
+
+void OLED::invalidateState()
+{
+    _stateKnown = 0;
+}
+
+// Between commands is the one place the baud rate can safely change.
+void OLED::_checkLink()
+{
+    if (_linkFailures >= OLED_BAUD_FALLBACK_ERRORS && !_baudNegotiating)
+        _stepDownBaud();
 }
 
 
@@ -203,13 +475,172 @@ uint16_t OLED::_convertResolution(uint8_t resolutionResponse)
 
 
 
+//
+// Response timing
+//
+
+OLED::TimingClass OLED::_getTimingClass(uint8_t opcode, uint8_t subcode)
+{
+    switch (opcode)
+    {
+    case OLED_CMD_BAUD_AUTO:
+    case OLED_CMD_BAUD:
+        return TimingSlow;
+    case OLED_CMD_INFO:
+    case OLED_CMD_DRAW_STRING_TEXT:
+    case OLED_CMD_DRAW_STRING_GFX:
+    case OLED_CMD_DRAW_STRING_BUTTON:
+    case OLED_CMD_DRAW_CHAR_TEXT:
+    case OLED_CMD_DRAW_CHAR_GFX:
+        return TimingText;
+    case OLED_CMD_DRAW_LINE:
+    case OLED_CMD_DRAW_RECTANGLE:
+    case OLED_CMD_DRAW_TRIANGLE:
+    case OLED_CMD_DRAW_POLYGON:
+    case OLED_CMD_DRAW_CIRCLE:
+    case OLED_CMD_DRAW_USER_BITMAP:
+        return TimingDraw;
+    case OLED_CMD_CLEAR_SCREEN:
+    case OLED_CMD_REPLACE_BACKGROUND:
+    case OLED_CMD_REPLACE_COLOR:
+    case OLED_CMD_SCREEN_COPY_PASTE:
+    case OLED_CMD_DRAW_IMAGE:
+        return TimingScreen;
+    case OLED_CMD_EXTENDED_SD:
+        switch (subcode)
+        {
+        case OLED_CMD_SD_INITIALIZE_CARD:
+        case OLED_CMD_SD_READ_SECTOR_BLOCK:
+        case OLED_CMD_SD_WRITE_SECTOR_BLOCK:
+            return TimingSDSector;
+        case OLED_CMD_SD_WRITE_SCREENSHOT:
+        case OLED_CMD_SD_DISPLAY_IMAGE:
+        case OLED_CMD_SD_DISPLAY_OBJECT:
+            return TimingSDScreen;
+        case OLED_CMD_SD_DISPLAY_VIDEO:
+        case OLED_CMD_SD_RUN_4DSL_SCRIPT:
+            return TimingSlow;
+        default:
+            return TimingQuick;
+        }
+    default:
+        return TimingQuick;
+    }
+}
+
+uint32_t OLED::_getScreenPixels()
+{
+    // Assume a 128x128 screen until we know better
+    return (_deviceWidth > 0 && _deviceHeight > 0)
+        ? (uint32_t)_deviceWidth * _deviceHeight
+        : 128UL * 128;
+}
+
+// A filled shape's bounding box, or the outline of it
+uint32_t OLED::_getShapePixels(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    uint32_t width = x2 - x1 + 1, height = y2 - y1 + 1;
+    return _fillShapes ? width * height : 2 * (width + height);
+}
+
+// Rough starting points for the fixed cost of each kind of command; these get replaced
+// by what the display actually takes. The time for the pixels a command touches comes
+// on top, from OLED_RESPONSE_PIXEL_NS, and isn't learned: a big fill after a run of
+// small ones would otherwise time out.
+uint32_t OLED::_getDefaultExecutionUs(TimingClass timingClass)
+{
+    switch (timingClass)
+    {
+    case TimingDraw:
+    case TimingText:
+        return 20000;
+    case TimingScreen:
+        return 10000;
+    case TimingSDSector:
+        return 100000;
+    case TimingSDScreen:
+        // Two bytes per pixel through the card
+        return 100000 + _getScreenPixels() * 4;
+    case TimingSlow:
+        return OLED_RESPONSE_TIMEOUT_MAX_US;
+    case TimingQuick:
+    default:
+        return 2000;
+    }
+}
+
+void OLED::resetResponseTimeouts()
+{
+    for (uint8_t c = 0; c < TimingClassCount; c++)
+        _executionUs[c] = _getDefaultExecutionUs((TimingClass)c);
+}
+
+// Time for one byte (start + 8 data + stop bits) at the current baud rate.
+uint32_t OLED::_getByteTimeUs()
+{
+    uint32_t baud = _serialBaud > 0 ? _serialBaud : OLED_BAUD_DEFAULT;
+    return (10000000UL + baud - 1) / baud;
+}
+
+// How long to wait for the first byte of the response to the command just sent.
+// Consumes the command, so the following bytes get the short per-byte timeout.
+uint32_t OLED::_getCommandTimeout()
+{
+    // The command may still be sitting in the transmit buffer,
+    // and the first response byte has to come back over the wire too.
+    _commandTxUs = _getByteTimeUs() * (_commandLength + 1);
+    OLED_TELEMETRY_RECORD(commandSent(_commandOpcode, _commandSubcode, _commandLength));
+    _commandLength = 0;
+    uint32_t pixelUs = _commandPixels * OLED_RESPONSE_PIXEL_NS / 1000;
+    _commandPixels = 0;
+
+    TimingClass timingClass = _getTimingClass(_commandOpcode, _commandSubcode);
+    return (_executionUs[timingClass] + pixelUs) * OLED_RESPONSE_TIMEOUT_MARGIN +
+        _commandTxUs + OLED_RESPONSE_TIMEOUT_SLACK_US;
+}
+
+// Moves the estimate for the last command's class a quarter of the way towards what we saw,
+// but never below a quarter of the built-in estimate so one lucky command can't make it too tight.
+void OLED::_learnLatency(uint32_t elapsedUs)
+{
+    TimingClass timingClass = _getTimingClass(_commandOpcode, _commandSubcode);
+    if (timingClass == TimingSlow)
+        return;
+
+    uint32_t observed = elapsedUs > _commandTxUs ? elapsedUs - _commandTxUs : 0;
+    uint32_t estimate = _executionUs[timingClass];
+    if (observed > estimate)
+        estimate += (observed - estimate) / 4;
+    else
+        estimate -= (estimate - observed) / 4;
+
+    uint32_t floor = _getDefaultExecutionUs(timingClass) / 4;
+    _executionUs[timingClass] = max(estimate, floor);
+}
+
+
+
 //
 // OLED read/write functions
 //
 
+// Bytes are collected into a frame and handed to the serial port in one call,
+// rather than making a virtual call into the container for every byte.
 void OLED::write(uint8_t value)
 {
-    _serial->write(value);
+    // Remember what kind of command this is, for working out how long to wait for it.
+    if (_commandLength == 0)
+    {
+        _checkLink();
+        _commandOpcode = value;
+    }
+    else if (_commandLength == 1)
+        _commandSubcode = value;
+    _commandLength++;
+
+    _frame[_frameLength++] = value;
+    if (_frameLength >= OLED_FRAME_BUFFER_SIZE)
+        sendFrame();
 }
 
 void OLED::write(uint8_t numValues, uint8_t value1, ...)
@@ -227,9 +658,58 @@ void OLED::write(uint8_t numValues, uint8_t value1, ...)
     va_end(ap);
 }
 
+void OLED::write(const uint8_t *values, uint16_t numValues)
+{
+    if (numValues == 0)
+        return;
+    if (_commandLength == 0)
+    {
+        _checkLink();
+        _commandOpcode = values[0];
+    }
+    if (_commandLength <= 1 && _commandLength + numValues > 1)
+        _commandSubcode = values[1 - _commandLength];
+    _commandLength += numValues;
+
+    if (_frameLength + numValues <= OLED_FRAME_BUFFER_SIZE)
+    {
+        memcpy(_frame + _frameLength, values, numValues);
+        _frameLength += numValues;
+        if (_frameLength >= OLED_FRAME_BUFFER_SIZE)
+            sendFrame();
+        return;
+    }
+    // Too big for the frame; send what we have and pass the rest straight through.
+    sendFrame();
+    if (_async)
+        _queueBytes(values, numValues);
+    else
+        _serial->write(values, numValues);
+}
+
+void OLED::sendFrame()
+{
+    if (_async)
+    {
+        _queueBytes(_frame, _frameLength);
+        _frameLength = 0;
+    }
+    else
+        _writeFrame();
+}
+
+void OLED::_writeFrame()
+{
+    if (_frameLength == 0)
+        return;
+    _serial->write(_frame, _frameLength);
+    _frameLength = 0;
+}
+
 void OLED::writeShort(uint16_t value)
 {
-    write(2, OLEDUtil::getByte(value, 1), OLEDUtil::getByte(value));
+    write(OLEDUtil::getByte(value, 1));
+    write(OLEDUtil::getByte(value));
 }
 
 void OLED::writeShort(uint8_t numValues, uint16_t value1, ...)
@@ -271,26 +751,46 @@ void OLED::writeLong(uint8_t numValues, uint32_t value1, ...)
     va_end(ap);
 }
 
-void OLED::writeText(char* text)
+void OLED::writeText(const char *text)
 {
-    for(uint32_t c = 0; c < strlen(text); c++)
-    {
-        if (text[c] == 0x00)
-            return;
-        write(text[c]);
-    }
+    _writeText(text, 0xFFFF, false);
+}
+
+void OLED::writeText(const char *text, uint16_t length)
+{
+    _writeText(text, length, false);
+}
+
+void OLED::writeText(const __FlashStringHelper *text)
+{
+    _writeText((const char *)text, 0xFFFF, true);
 }
 
-void OLED::writeString(String text)
+void OLED::writeString(const String &text)
 {
-    for(uint32_t c = 0; c < text.length(); c++)
+    _writeText(text.c_str(), text.length(), false);
+}
+
+void OLED::_writeText(const char *text, uint16_t length, bool progmem)
+{
+    for (uint16_t c = 0; c < length; c++)
     {
-        if (text[c] == 0x00)
+        char character = progmem ? pgm_read_byte(text + c) : text[c];
+        if (character == 0x00)
             return;
-        write(text[c]);
+        write(character);
     }
 }
 
+// Characters before the first NUL, at most `length`
+uint16_t OLED::_getTextLength(const char *text, uint16_t length, bool progmem)
+{
+    uint16_t c = 0;
+    while (c < length && (progmem ? pgm_read_byte(text + c) : text[c]) != 0x00)
+        c++;
+    return c;
+}
+
 void OLED::writeSpatial(uint16_t value)
 {
     if (_controllerType == Picaso)
@@ -317,16 +817,50 @@ void OLED::writeSpatial(uint8_t numValues, uint16_t value1, ...)
 
 bool OLED::getResponse(uint8_t& result)
 {
-    for (uint32_t i = 0; i < OLED_RESPONSE_RETRIES; i++)
+    // Responses arrive in order, so earlier ACKs have to be read out of the way first.
+    drainPipeline();
+    return _readResponse(result);
+}
+
+bool OLED::_readResponse(uint8_t& result)
+{
+    _writeFrame();
+
+    // The first byte of a response waits for the command to execute;
+    // the rest only have to cross the wire.
+    if (_commandLength == 0)
     {
-        if (_serial->available())
+        if (!_waitForByte(result, _getByteTimeUs() * OLED_RESPONSE_TIMEOUT_MARGIN +
+            OLED_RESPONSE_TIMEOUT_SLACK_US))
         {
-            result = _serial->read();
-            return true;
+            OLED_TELEMETRY_RECORD(byteTimedOut());
+            return false;
         }
-        delayMicroseconds(OLED_RESPONSE_RETRY_DELAY_US);
+        OLED_TELEMETRY_RECORD(byteReceived());
+        return true;
     }
-    return false;
+
+    uint32_t timeout = _getCommandTimeout();
+    uint32_t start = micros();
+    if (!_waitForByte(result, timeout))
+    {
+        OLED_TELEMETRY_RECORD(responseTimedOut());
+        return false;
+    }
+    OLED_TELEMETRY_RECORD(responseStarted());
+    OLED_TELEMETRY_RECORD(byteReceived());
+    _learnLatency(micros() - start);
+    return true;
+}
+
+bool OLED::_waitForByte(uint8_t& result, uint32_t timeoutUs)
+{
+    if (timeoutUs > OLED_RESPONSE_TIMEOUT_MAX_US)
+        timeoutUs = OLED_RESPONSE_TIMEOUT_MAX_US;
+    if (!_serial->waitForData(timeoutUs))
+        return false;
+    result = _serial->read();
+    return true;
 }
 
 bool OLED::getResponseShort(uint16_t& result)
@@ -339,40 +873,329 @@ bool OLED::getResponseShort(uint16_t& result)
 }
 
 bool OLED::getAck()
+{
+    uint16_t errors = _pipelineErrors;
+    if (_async)
+    {
+        _queueCommand();
+        return _pipelineErrors == errors;
+    }
+    if (_pipelineDepth <= 1)
+        return _waitForAck();
+
+    sendFrame();
+    _pendingTimeoutUs += _getCommandTimeout();
+    _pendingAcks++;
+    // Pick up any ACKs that have already arrived, and block only when the pipeline is full.
+    while (_pendingAcks >= _pipelineDepth ||
+        (_pendingAcks > 0 && _serial->available()))
+        _collectAck();
+    return _pipelineErrors == errors;
+}
+
+bool OLED::_waitForAck()
+{
+    uint8_t result;
+    bool received = getResponse(result);
+    bool success = received && result == OLED_ACK;
+    if (received)
+        OLED_TELEMETRY_RECORD(acknowledged(success));
+    if (success)
+        _ackCount++;
+    _noteLinkResult(received, result);
+    return success;
+}
+
+bool OLED::_collectAck()
 {
     uint8_t result;
-    return (getResponse(result) && result == OLED_ACK);
+    _writeFrame();
+    // Commands ahead of this one may still be executing, so allow for all of them,
+    // then take back an average share once the ACK is in.
+    bool received = _waitForByte(result, _pendingTimeoutUs);
+    _pendingTimeoutUs -= _pendingTimeoutUs / _pendingAcks;
+    _pendingAcks--;
+    if (!received)
+    {
+        // Nothing came back, so the remaining ACKs can't be matched to commands anymore.
+        // Late ones would be taken for the ACKs of the commands that come next, so let
+        // whatever is still executing finish and throw its ACKs away.
+        OLED_TELEMETRY_RECORD(responseTimedOut());
+        OLED_TELEMETRY_RECORD(clearInFlight());
+        _discardInput(OLED_RESPONSE_TIMEOUT_MAX_US);
+        _pendingAcks = 0;
+        _pendingTimeoutUs = 0;
+        _pipelineErrors++;
+        _resolveAck(false);
+        _noteLinkResult(false, 0);
+        return false;
+    }
+    OLED_TELEMETRY_RECORD(responseStarted());
+    OLED_TELEMETRY_RECORD(byteReceived());
+    OLED_TELEMETRY_RECORD(acknowledged(result == OLED_ACK));
+    _noteLinkResult(true, result);
+    _resolveAck(result == OLED_ACK);
+    if (result != OLED_ACK)
+    {
+        _pipelineErrors++;
+        return false;
+    }
+    _ackCount++;
+    return true;
+}
+
+
+// Called as each outstanding ACK comes in (or doesn't). Settings and user bitmaps are
+// taken as sent as soon as their command is, and a failure can't be matched to its
+// command, so it makes every setting go out again and drops the unconfirmed bitmaps.
+void OLED::_resolveAck(bool success)
+{
+    if (!success)
+    {
+        invalidateState();
+        for (uint8_t i = 0; i < OLED_MAX_USER_BITMAPS; i++)
+        {
+            if (_unconfirmedBitmaps & ((uint32_t)1 << i))
+                _charIndexList[i] = false;
+        }
+    }
+    if (!success || (_pendingAcks == 0 && _asyncCommandCount == 0))
+        _unconfirmedBitmaps = 0;
+    _resolveShadow(success);
 }
 
+// Throws away whatever arrives until nothing has for timeoutUs.
+void OLED::_discardInput(uint32_t timeoutUs)
+{
+    while (_serial->waitForData(timeoutUs))
+        _serial->read();
+}
 
 
 //
-// OLED general/system commands
+// Pipelined mode
 //
 
+void OLED::setPipelineDepth(uint8_t depth)
+{
+    drainPipeline();
+    // ACKs arriving while the next command goes out would be lost on a half-duplex port.
+    _pipelineDepth = _serial->isFullDuplex() ? depth : 1;
+}
 
+uint8_t OLED::getPipelineDepth() { return _pipelineDepth; }
+uint8_t OLED::getPendingAcks() { return _pendingAcks; }
+uint32_t OLED::getAckCount() { return _ackCount; }
+uint16_t OLED::getPipelineErrors() { return _pipelineErrors; }
 
-bool OLED::getDeviceInfo(bool displayOnScreen)
+// Waits for every outstanding ACK, including everything in the asynchronous queue.
+// Returns false if any pipelined command has failed since the errors were last cleared.
+bool OLED::drainPipeline()
 {
-    uint8_t output = displayOnScreen
-        ? OLED_PRM_BOOL_TRUE
-        : OLED_PRM_BOOL_FALSE;
+    while (_pendingAcks > 0)
+        _collectAck();
+    while (_asyncByteCount > 0 || _asyncCommandCount > 0)
+        poll();
+    return _pipelineErrors == 0;
+}
 
-    write(2, OLED_CMD_INFO, output);
+void OLED::clearPipelineErrors()
+{
+    _pipelineErrors = 0;
+    _ackCount = 0;
+}
 
-    uint8_t response[5];
 
-    uint8_t hw, fw;
-    if (!getResponse(response[0]) ||
-        !getResponse(response[1]) || 
-        !getResponse(response[2]) ||
-        !getResponse(response[3]) ||
-        !getResponse(response[4]) ||
-        !OLEDUtil::readHexAsDec(response[1], hw) ||
-        !OLEDUtil::readHexAsDec(response[2], fw))
-        return false;
-    
-    _deviceType = _convertDeviceType(response[0]);
+//
+// Asynchronous mode
+//
+
+void OLED::setAsync(bool enabled)
+{
+    if (enabled == _async)
+        return;
+
+    drainPipeline();
+    sendFrame();
+    if (enabled)
+    {
+        // Only pay for the queue when it's in use.
+        _asyncBytes = new uint8_t[OLED_ASYNC_QUEUE_BYTES];
+        _asyncCommands = new QueuedCommand[OLED_ASYNC_QUEUE_COMMANDS];
+    }
+    else
+    {
+        delete[] _asyncBytes;
+        delete[] _asyncCommands;
+        _asyncBytes = 0;
+        _asyncCommands = 0;
+    }
+    _clearQueue();
+    _async = enabled;
+}
+
+bool OLED::isAsync() { return _async; }
+bool OLED::isQueueEmpty() { return _asyncByteCount == 0 && _asyncCommandCount == 0; }
+uint8_t OLED::getQueuedCommands() { return _asyncCommandCount; }
+uint16_t OLED::getLastHandle() { return _asyncNextHandle - 1; }
+void OLED::setCompletionCallback(OLEDCommandCallback callback) { _asyncCallback = callback; }
+
+// Handles are issued in order, so anything older than the oldest queued command is done.
+bool OLED::isComplete(uint16_t handle)
+{
+    if (_asyncCommandCount == 0)
+        return true;
+    return (int16_t)(handle - _asyncCommands[_asyncCommandHead].handle) < 0;
+}
+
+// Transmits up to OLED_ASYNC_POLL_BYTES queued bytes without blocking (on hardware serial),
+// then completes whichever sent commands have been answered or have timed out.
+void OLED::poll()
+{
+    if (!_async)
+        return;
+
+    // Asked once: a transport without a TX buffer (SoftwareSerial) always says 1, and
+    // blocks for every byte, so it gets one byte per call.
+    int room = _serial->availableForWrite();
+    uint16_t budget = room > 0 ? min((uint16_t)room, (uint16_t)OLED_ASYNC_POLL_BYTES) : 0;
+    while (_asyncByteCount > 0 && budget > 0)
+    {
+        uint16_t chunk = min(budget, _asyncByteCount);
+        chunk = min(chunk, (uint16_t)(OLED_ASYNC_QUEUE_BYTES - _asyncByteHead));
+        _serial->write(_asyncBytes + _asyncByteHead, chunk);
+        _asyncByteHead = (_asyncByteHead + chunk) % OLED_ASYNC_QUEUE_BYTES;
+        _asyncByteCount -= chunk;
+        _asyncBytesSent += chunk;
+        budget -= chunk;
+    }
+
+    while (_asyncCommandCount > 0)
+    {
+        QueuedCommand &head = _asyncCommands[_asyncCommandHead];
+        // Not completely sent yet, so no ACK to expect.
+        if ((int32_t)(_asyncBytesSent - head.end) < 0)
+            break;
+
+        if (_serial->available())
+        {
+            uint8_t result = _serial->read();
+            OLED_TELEMETRY_RECORD(responseStarted());
+            OLED_TELEMETRY_RECORD(byteReceived());
+            OLED_TELEMETRY_RECORD(acknowledged(result == OLED_ACK));
+            _noteLinkResult(true, result);
+            _completeCommand(result == OLED_ACK);
+            continue;
+        }
+        if (!_asyncWaiting)
+        {
+            _asyncWaiting = true;
+            _asyncWaitStart = micros();
+        }
+        else if (micros() - _asyncWaitStart > head.timeoutUs)
+        {
+            // As in _collectAck: a late ACK would be taken for the next command's, so let
+            // everything already sent finish, throw its ACKs away and fail all of it.
+            OLED_TELEMETRY_RECORD(responseTimedOut());
+            OLED_TELEMETRY_RECORD(clearInFlight());
+            _noteLinkResult(false, 0);
+            _discardInput(OLED_RESPONSE_TIMEOUT_MAX_US);
+            while (_asyncCommandCount > 0 &&
+                (int32_t)(_asyncBytesSent - _asyncCommands[_asyncCommandHead].end) >= 0)
+                _completeCommand(false);
+            break;
+        }
+        break;
+    }
+}
+
+void OLED::_queueBytes(const uint8_t *values, uint16_t numValues)
+{
+    for (uint16_t i = 0; i < numValues; i++)
+    {
+        while (_asyncByteCount >= OLED_ASYNC_QUEUE_BYTES)
+            poll();
+        _asyncBytes[(_asyncByteHead + _asyncByteCount) % OLED_ASYNC_QUEUE_BYTES] = values[i];
+        _asyncByteCount++;
+        _asyncBytesQueued++;
+    }
+}
+
+// Marks everything queued so far as one command awaiting an ACK.
+void OLED::_queueCommand()
+{
+    sendFrame();
+    while (_asyncCommandCount >= OLED_ASYNC_QUEUE_COMMANDS)
+        poll();
+    QueuedCommand &command =
+        _asyncCommands[(_asyncCommandHead + _asyncCommandCount) % OLED_ASYNC_QUEUE_COMMANDS];
+    command.end = _asyncBytesQueued;
+    command.handle = _asyncNextHandle++;
+    command.timeoutUs = _getCommandTimeout();
+    _asyncCommandCount++;
+}
+
+void OLED::_completeCommand(bool success)
+{
+    uint16_t handle = _asyncCommands[_asyncCommandHead].handle;
+    _asyncCommandHead = (_asyncCommandHead + 1) % OLED_ASYNC_QUEUE_COMMANDS;
+    _asyncCommandCount--;
+    _asyncWaiting = false;
+
+    if (success)
+        _ackCount++;
+    else
+        _pipelineErrors++;
+    _resolveAck(success);
+
+    if (_asyncCallback)
+        _asyncCallback(handle, success);
+}
+
+#if OLED_TELEMETRY
+OLEDTelemetry &OLED::getTelemetry() { return _telemetry; }
+#endif
+
+void OLED::_clearQueue()
+{
+    _asyncByteHead = 0;
+    _asyncByteCount = 0;
+    _asyncBytesQueued = 0;
+    _asyncBytesSent = 0;
+    _asyncCommandHead = 0;
+    _asyncCommandCount = 0;
+    _asyncWaiting = false;
+}
+
+
+
+//
+// OLED general/system commands
+//
+
+
+
+bool OLED::getDeviceInfo(bool displayOnScreen)
+{
+    uint8_t output = displayOnScreen
+        ? OLED_PRM_BOOL_TRUE
+        : OLED_PRM_BOOL_FALSE;
+
+    write(2, OLED_CMD_INFO, output);
+
+    uint8_t response[5];
+
+    uint8_t hw, fw;
+    if (!getResponse(response[0]) ||
+        !getResponse(response[1]) || 
+        !getResponse(response[2]) ||
+        !getResponse(response[3]) ||
+        !getResponse(response[4]) ||
+        !OLEDUtil::readHexAsDec(response[1], hw) ||
+        !OLEDUtil::readHexAsDec(response[2], fw))
+        return false;
+    
+    _deviceType = _convertDeviceType(response[0]);
     _hardwareRevision = hw;
     _firmwareRevision = fw;
     if (response[3] != OLED_RES_UNKNOWN &&
@@ -423,8 +1246,24 @@ bool OLED::_getDeviceResolution()
 
 bool OLED::clear()
 {
-    write(OLED_CMD_CLEAR_SCREEN);
-    return getAck();
+    if (_inFrame)
+    {
+        bool fillShapes = _fillShapes;
+        bool result = setFill(true) && _sendRectangle(_frontX, _frontY,
+            _frontX + _frameWidth - 1, _frontY + _frameHeight - 1, _background);
+        return setFill(fillShapes) && result;
+    }
+    OLEDCommands::clear(*this);
+    _commandPixels = _getScreenPixels();
+    if (!getAck())
+    {
+        _markShadowUnknown(0, 0, getDeviceWidth() - 1, getDeviceHeight() - 1);
+        return false;
+    }
+    _markShadowUnconfirmed(0, 0, getDeviceWidth() - 1, getDeviceHeight() - 1);
+    if (_shadow)
+        _shadow->clear(_background);
+    return true;
 }
 
 
@@ -614,15 +1453,48 @@ bool OLED::tune(uint8_t length, uint16_t note, uint16_t duration)
 
 bool OLED::readPixel(uint16_t x, uint16_t y, uint16_t& resultShort)
 {
+    x += _originX;
+    y += _originY;
     if (x < 0 || x >= getDeviceWidth() ||
         y < 0 || y >= getDeviceHeight())
         return false;
-    write(OLED_CMD_READ_PIXEL);
-    writeSpatial(2, x, y);
-    
-    if (!getResponseShort(resultShort))
+
+    // A reduced-resolution shadow only approximates single pixels, so ask the display.
+    uint16_t shadowColor;
+    if (_shadow && _shadow->isExact() && _shadow->getPixel(x, y, shadowColor))
+    {
+        if (_shadowVerifyInterval == 0 || ++_shadowReads < _shadowVerifyInterval)
+        {
+            resultShort = shadowColor;
+            return true;
+        }
+        _shadowReads = 0;
+        return _checkShadowPixel(x, y, shadowColor, resultShort);
+    }
+
+    if (!_readDevicePixel(x, y, resultShort))
         return false;
-        
+    if (_shadow)
+        _shadow->drawPixel(x, y, resultShort);
+    return true;
+}
+
+bool OLED::_readDevicePixel(uint16_t x, uint16_t y, uint16_t &color)
+{
+    OLEDCommands::readPixel(*this, x, y);
+    return getResponseShort(color);
+}
+
+// Reads a shadowed pixel back from the display, counting and fixing any difference.
+bool OLED::_checkShadowPixel(uint16_t x, uint16_t y, uint16_t expected, uint16_t &actual)
+{
+    if (!_readDevicePixel(x, y, actual))
+        return false;
+    if (actual != expected)
+    {
+        _shadowMismatches++;
+        _shadow->drawPixel(x, y, actual);
+    }
     return true;
 }
 
@@ -638,10 +1510,39 @@ bool OLED::readPixel(uint16_t x, uint16_t y, Color& resultColor)
 
 bool OLED::drawPixel(uint16_t x, uint16_t y, uint16_t color)
 {
-    write(OLED_CMD_DRAW_PIXEL);
-    writeSpatial(2, x, y);
-    writeShort(color);
-    return getAck();
+    int32_t clipX1, clipY1, clipX2, clipY2;
+    if (!_getClip(clipX1, clipY1, clipX2, clipY2) ||
+        _signed(x) < clipX1 || _signed(x) > clipX2 ||
+        _signed(y) < clipY1 || _signed(y) > clipY2)
+        return true;
+
+    if (_batchingPixels)
+    {
+        bool result = true;
+        int16_t index = _findBatchPixel(x, y);
+        if (index < 0)
+        {
+            if (_pixelBatchCount >= OLED_PIXEL_BATCH_SIZE)
+                result = flushPixels();
+            index = _pixelBatchCount++;
+            _pixelBatch[index].x = x;
+            _pixelBatch[index].y = y;
+        }
+        _pixelBatch[index].color = color;
+        return result;
+    }
+
+    _toBackBuffer(x, y);
+    OLEDCommands::pixel(*this, x, y, color);
+    if (!getAck())
+    {
+        _markShadowUnknown(x, y, x, y);
+        return false;
+    }
+    _markShadowUnconfirmed(x, y, x, y);
+    if (_shadow)
+        _shadow->drawPixel(x, y, color);
+    return true;
 }
 
 bool OLED::drawPixel(uint16_t x, uint16_t y, Color color)
@@ -649,13 +1550,230 @@ bool OLED::drawPixel(uint16_t x, uint16_t y, Color color)
     return drawPixel(x, y, color.to16BitRGB());
 }
 
+bool OLED::beginPixels()
+{
+    if (!_pixelBatch)
+    {
+        // Only pay for the batch while it's in use.
+        _pixelBatch = new BatchPixel[OLED_PIXEL_BATCH_SIZE];
+        _pixelBatchCount = 0;
+    }
+    _batchingPixels = _pixelBatch != 0;
+    return _batchingPixels;
+}
+
+bool OLED::endPixels()
+{
+    bool result = flushPixels();
+    _batchingPixels = false;
+    delete[] _pixelBatch;
+    _pixelBatch = 0;
+    _pixelBatchCount = 0;
+    return result;
+}
+
+bool OLED::flushPixels()
+{
+    if (!_batchingPixels || _pixelBatchCount == 0)
+        return true;
+    // Everything from here on is drawn for real.
+    _batchingPixels = false;
+
+    // Sorted by row, then column, runs sit next to each other.
+    for (uint8_t i = 1; i < _pixelBatchCount; i++)
+    {
+        BatchPixel pixel = _pixelBatch[i];
+        uint8_t j = i;
+        for (; j > 0 && (_pixelBatch[j - 1].y > pixel.y ||
+            (_pixelBatch[j - 1].y == pixel.y && _pixelBatch[j - 1].x > pixel.x)); j--)
+            _pixelBatch[j] = _pixelBatch[j - 1];
+        _pixelBatch[j] = pixel;
+    }
+
+    uint16_t x1 = 0xFFFF, y1 = _pixelBatch[0].y, x2 = 0, y2 = _pixelBatch[_pixelBatchCount - 1].y;
+    for (uint8_t i = 0; i < _pixelBatchCount; i++)
+    {
+        x1 = min(x1, _pixelBatch[i].x);
+        x2 = max(x2, _pixelBatch[i].x);
+    }
+
+    // One image of the whole area beats lots of small commands once the batch is dense,
+    // but only if every pixel in it is known: from the batch, or from the shadow.
+    uint32_t runCost;
+    _sendPixelRuns(false, runCost);
+    uint8_t spatialBytes = _controllerType == Picaso ? 2 : 1;
+    uint32_t area = (uint32_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+    bool useImage = 2 + 4 * spatialBytes + area * 2 + OLED_PIXEL_BATCH_COMMAND_COST < runCost;
+    for (uint16_t y = y1; y <= y2 && useImage; y++)
+    {
+        for (uint16_t x = x1; x <= x2 && useImage; x++)
+        {
+            uint16_t color;
+            useImage = _findBatchPixel(x, y) >= 0 ||
+                (_shadow && _shadow->isExact() &&
+                    _shadow->getPixel(x + _originX, y + _originY, color));
+        }
+    }
+
+    bool result = useImage
+        ? _sendPixelImage(x1, y1, x2, y2)
+        : _sendPixelRuns(true, runCost);
+    _pixelBatchCount = 0;
+    _batchingPixels = true;
+    return result;
+}
+
+int16_t OLED::_findBatchPixel(uint16_t x, uint16_t y)
+{
+    for (uint8_t i = 0; i < _pixelBatchCount; i++)
+    {
+        if (_pixelBatch[i].x == x && _pixelBatch[i].y == y)
+            return i;
+    }
+    return -1;
+}
+
+// Whether the batch (sorted) holds unsent pixels of this color from `first` along to x2.
+bool OLED::_isBatchRun(int16_t first, uint16_t x2, uint16_t y, uint16_t color)
+{
+    uint16_t x1 = _pixelBatch[first].x;
+    if (first + (x2 - x1) >= _pixelBatchCount)
+        return false;
+    for (uint16_t x = x1; x <= x2; x++)
+    {
+        const BatchPixel &pixel = _pixelBatch[first + (x - x1)];
+        if (pixel.x != x || pixel.y != y || pixel.color != color || pixel.sent)
+            return false;
+    }
+    return true;
+}
+
+// Sends the (sorted) batch as horizontal runs, grown downwards into rectangles when shapes
+// are filled, then vertical runs, then single pixels. Without `send`, only adds up the bytes.
+bool OLED::_sendPixelRuns(bool send, uint32_t &cost)
+{
+    uint8_t spatialBytes = _controllerType == Picaso ? 2 : 1;
+    bool result = true;
+    cost = 0;
+    for (uint8_t i = 0; i < _pixelBatchCount; i++)
+        _pixelBatch[i].sent = false;
+
+    for (uint8_t i = 0; i < _pixelBatchCount; i++)
+    {
+        BatchPixel &pixel = _pixelBatch[i];
+        if (pixel.sent)
+            continue;
+        uint16_t x2 = pixel.x;
+        while (_isBatchRun(i, x2 + 1, pixel.y, pixel.color))
+            x2++;
+        if (x2 == pixel.x)
+            continue;
+        uint16_t y2 = pixel.y;
+        int16_t below;
+        while (_fillShapes && (below = _findBatchPixel(pixel.x, y2 + 1)) >= 0 &&
+            _isBatchRun(below, x2, y2 + 1, pixel.color))
+            y2++;
+        for (uint16_t y = pixel.y; y <= y2; y++)
+        {
+            int16_t first = _findBatchPixel(pixel.x, y);
+            for (uint16_t x = pixel.x; x <= x2; x++)
+                _pixelBatch[first + (x - pixel.x)].sent = true;
+        }
+        cost += 3 + 4 * spatialBytes + OLED_PIXEL_BATCH_COMMAND_COST;
+        if (send)
+            result = (y2 > pixel.y
+                ? drawRectangle(pixel.x, pixel.y, x2, y2, pixel.color)
+                : drawLine(pixel.x, pixel.y, x2, y2, pixel.color)) && result;
+    }
+
+    for (uint8_t i = 0; i < _pixelBatchCount; i++)
+    {
+        BatchPixel &pixel = _pixelBatch[i];
+        if (pixel.sent)
+            continue;
+        pixel.sent = true;
+        uint16_t y2 = pixel.y;
+        int16_t below;
+        while ((below = _findBatchPixel(pixel.x, y2 + 1)) >= 0 &&
+            !_pixelBatch[below].sent && _pixelBatch[below].color == pixel.color)
+        {
+            _pixelBatch[below].sent = true;
+            y2++;
+        }
+        if (y2 > pixel.y)
+        {
+            cost += 3 + 4 * spatialBytes + OLED_PIXEL_BATCH_COMMAND_COST;
+            if (send)
+                result = drawLine(pixel.x, pixel.y, pixel.x, y2, pixel.color) && result;
+        }
+        else
+        {
+            cost += 3 + 2 * spatialBytes + OLED_PIXEL_BATCH_COMMAND_COST;
+            if (send)
+                result = drawPixel(pixel.x, pixel.y, pixel.color) && result;
+        }
+    }
+    return result;
+}
+
+// Sends the batch's bounding box as one 16 bit image, filling the gaps from the shadow.
+bool OLED::_sendPixelImage(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    // The batch keeps the coordinates it was drawn with.
+    uint16_t imageX = x1, imageY = y1, imageX2 = x2, imageY2 = y2;
+    _toBackBuffer(imageX, imageY);
+    _toBackBuffer(imageX2, imageY2);
+    _writeImageHeader(imageX, imageY, x2 - x1 + 1, y2 - y1 + 1, 2);
+    for (uint16_t y = y1; y <= y2; y++)
+    {
+        for (uint16_t x = x1; x <= x2; x++)
+        {
+            uint16_t color = 0;
+            int16_t index = _findBatchPixel(x, y);
+            if (index >= 0)
+                color = _pixelBatch[index].color;
+            else
+                _shadow->getPixel(x + _originX, y + _originY, color);
+            writeShort(color);
+        }
+    }
+    if (!getAck())
+    {
+        _markShadowUnknown(imageX, imageY, imageX2, imageY2);
+        return false;
+    }
+    _markShadowUnconfirmed(imageX, imageY, imageX2, imageY2);
+    for (uint8_t i = 0; i < _pixelBatchCount && _shadow; i++)
+        _shadow->drawPixel(_pixelBatch[i].x + _originX, _pixelBatch[i].y + _originY,
+            _pixelBatch[i].color);
+    return true;
+}
+
 
 bool OLED::drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
 {
-    write(OLED_CMD_DRAW_LINE);
-    writeSpatial(4, x1, y1, x2, y2);
-    writeShort(color);
-    return getAck();
+    int32_t clippedX1 = _signed(x1), clippedY1 = _signed(y1);
+    int32_t clippedX2 = _signed(x2), clippedY2 = _signed(y2);
+    if (!_clipLine(clippedX1, clippedY1, clippedX2, clippedY2))
+        return true;
+    return _sendLine(clippedX1, clippedY1, clippedX2, clippedY2, color);
+}
+
+bool OLED::_sendLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+{
+    _toBackBuffer(x1, y1);
+    _toBackBuffer(x2, y2);
+    OLEDCommands::line(*this, x1, y1, x2, y2, color);
+    _commandPixels = max(max(x1, x2) - min(x1, x2), max(y1, y2) - min(y1, y2)) + 1;
+    if (!getAck())
+    {
+        _markShadowUnknown(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2));
+        return false;
+    }
+    _markShadowUnconfirmed(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2));
+    if (_shadow)
+        _shadow->drawLine(x1, y1, x2, y2, color);
+    return true;
 }
 
 bool OLED::drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
@@ -666,10 +1784,40 @@ bool OLED::drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color co
 
 bool OLED::drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
 {
-    write(OLED_CMD_DRAW_RECTANGLE);
-    writeSpatial(4, x1, y1, x2, y2);
-    writeShort(color);
-    return getAck();
+    int32_t left = min(_signed(x1), _signed(x2)), right = max(_signed(x1), _signed(x2));
+    int32_t top = min(_signed(y1), _signed(y2)), bottom = max(_signed(y1), _signed(y2));
+    int32_t clipX1, clipY1, clipX2, clipY2;
+    if (!_getClip(clipX1, clipY1, clipX2, clipY2) ||
+        right < clipX1 || left > clipX2 || bottom < clipY1 || top > clipY2)
+        return true;
+    if (left >= clipX1 && right <= clipX2 && top >= clipY1 && bottom <= clipY2)
+        return _sendRectangle(left, top, right, bottom, color);
+
+    if (_fillShapes)
+        return _sendRectangle(max(left, clipX1), max(top, clipY1),
+            min(right, clipX2), min(bottom, clipY2), color);
+    // An outline loses the sides that were cut off.
+    bool result = drawLine(left, top, right, top, color);
+    result = drawLine(right, top, right, bottom, color) && result;
+    result = drawLine(right, bottom, left, bottom, color) && result;
+    return drawLine(left, bottom, left, top, color) && result;
+}
+
+bool OLED::_sendRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+{
+    _toBackBuffer(x1, y1);
+    _toBackBuffer(x2, y2);
+    OLEDCommands::rectangle(*this, x1, y1, x2, y2, color);
+    _commandPixels = _getShapePixels(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2));
+    if (!getAck())
+    {
+        _markShadowUnknown(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2));
+        return false;
+    }
+    _markShadowUnconfirmed(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2));
+    if (_shadow)
+        _shadow->drawRectangle(x1, y1, x2, y2, color, _fillShapes);
+    return true;
 }
 
 bool OLED::drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
@@ -694,10 +1842,12 @@ bool OLED::drawRectangleWH(uint16_t x, uint16_t y, uint16_t width, uint16_t heig
 bool OLED::drawProgressBar(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
     uint8_t progressPercent, uint16_t foreColor, uint16_t backColor)
 {
-    uint16_t progressWidth = width * progressPercent / 100;
+    uint16_t progressWidth = (uint32_t)width * min(progressPercent, (uint8_t)100) / 100;
+    // Either part can be empty.
     return
-        drawRectangleWH(x, y, progressWidth, height, foreColor) &&
-        drawRectangleWH(x+progressWidth, y, width-progressWidth, height, backColor);
+        (progressWidth == 0 || drawRectangleWH(x, y, progressWidth, height, foreColor)) &&
+        (progressWidth == width ||
+            drawRectangleWH(x+progressWidth, y, width-progressWidth, height, backColor));
 }
 
 bool OLED::drawProgressBar(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
@@ -711,10 +1861,45 @@ bool OLED::drawProgressBar(uint16_t x, uint16_t y, uint16_t width, uint16_t heig
 bool OLED::drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
     uint16_t color)
 {
-    write(OLED_CMD_DRAW_TRIANGLE);
-    writeSpatial(6, x1, y1, x2, y2, x3, y3);
-    writeShort(color);
-    return getAck();
+    int32_t clipX1, clipY1, clipX2, clipY2;
+    int32_t minX = min(_signed(x1), min(_signed(x2), _signed(x3)));
+    int32_t maxX = max(_signed(x1), max(_signed(x2), _signed(x3)));
+    int32_t minY = min(_signed(y1), min(_signed(y2), _signed(y3)));
+    int32_t maxY = max(_signed(y1), max(_signed(y2), _signed(y3)));
+    if (!_getClip(clipX1, clipY1, clipX2, clipY2) ||
+        maxX < clipX1 || minX > clipX2 || maxY < clipY1 || minY > clipY2)
+        return true;
+    if (minX >= clipX1 && maxX <= clipX2 && minY >= clipY1 && maxY <= clipY2)
+        return _sendTriangle(x1, y1, x2, y2, x3, y3, color);
+
+    if (_fillShapes)
+        return _drawClippedTriangle(_signed(x1), _signed(y1), _signed(x2), _signed(y2),
+            _signed(x3), _signed(y3), color);
+    bool result = drawLine(x1, y1, x2, y2, color);
+    result = drawLine(x2, y2, x3, y3, color) && result;
+    return drawLine(x3, y3, x1, y1, color) && result;
+}
+
+bool OLED::_sendTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
+    uint16_t color)
+{
+    _toBackBuffer(x1, y1);
+    _toBackBuffer(x2, y2);
+    _toBackBuffer(x3, y3);
+    OLEDCommands::triangle(*this, x1, y1, x2, y2, x3, y3, color);
+    _commandPixels = _getShapePixels(min(x1, min(x2, x3)), min(y1, min(y2, y3)),
+        max(x1, max(x2, x3)), max(y1, max(y2, y3)));
+    if (!getAck())
+    {
+        _markShadowUnknown(min(x1, min(x2, x3)), min(y1, min(y2, y3)),
+            max(x1, max(x2, x3)), max(y1, max(y2, y3)));
+        return false;
+    }
+    _markShadowUnconfirmed(min(x1, min(x2, x3)), min(y1, min(y2, y3)),
+        max(x1, max(x2, x3)), max(y1, max(y2, y3)));
+    if (_shadow)
+        _shadow->drawTriangle(x1, y1, x2, y2, x3, y3, color, _fillShapes);
+    return true;
 }
 
 bool OLED::drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
@@ -726,22 +1911,21 @@ bool OLED::drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint
 
 bool OLED::_drawPolygonVa(uint16_t color, uint8_t numVertices, uint16_t x1, uint16_t y1, va_list ap)
 {
-    // Vertex count limited by the serial interface
-    if (numVertices > OLED_MAX_POLYGON_VERTICES)
+    if (numVertices < 1)
         return false;
-    // Polygon must be at least 3 vertices, but no reason to flat-out reject it...
-    if (numVertices == 1)
-        return drawPixel(x1, y1, color);
-    if (numVertices == 2)
-        return drawLine(x1, y1, (uint16_t)va_arg(ap, int), (uint16_t)va_arg(ap, int), color);
-
-
-    write(2, OLED_CMD_DRAW_POLYGON, numVertices);
-    writeSpatial(2, x1, y1);
+    uint16_t (*vertices)[2] = new uint16_t[numVertices][2];
+    if (!vertices)
+        return false;
+    vertices[0][0] = x1;
+    vertices[0][1] = y1;
     for (uint8_t i = 1; i < numVertices; i++)
-        writeSpatial(2, (uint16_t)va_arg(ap, int), (uint16_t)va_arg(ap, int));
-    writeShort(color);
-    return getAck();
+    {
+        vertices[i][0] = (uint16_t)va_arg(ap, int);
+        vertices[i][1] = (uint16_t)va_arg(ap, int);
+    }
+    bool result = drawPolygon(color, numVertices, vertices);
+    delete[] vertices;
+    return result;
 }
 
 bool OLED::drawPolygon(uint16_t color, uint8_t numVertices, uint16_t x1, uint16_t y1, ...)
@@ -764,17 +1948,192 @@ bool OLED::drawPolygon(Color color, uint8_t numVertices, uint16_t x1, uint16_t y
 
 bool OLED::drawPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2])
 {
-    if (numVertices > OLED_MAX_POLYGON_VERTICES) return false;
+    if (numVertices < 1)
+        return false;
+    // Polygon must be at least 3 vertices, but no reason to flat-out reject it...
     if (numVertices == 1)
         return drawPixel(vertices[0][0], vertices[0][1], color);
     if (numVertices == 2)
         return drawLine(vertices[0][0], vertices[0][1], vertices[1][0], vertices[1][1], color);
-    
-    write(2, OLED_CMD_DRAW_POLYGON, numVertices);
+
+    int32_t clipX1, clipY1, clipX2, clipY2;
+    if (!_getClip(clipX1, clipY1, clipX2, clipY2))
+        return true;
+    bool inside = true;
+    for (uint8_t v = 0; v < numVertices && inside; v++)
+    {
+        inside = _signed(vertices[v][0]) >= clipX1 && _signed(vertices[v][0]) <= clipX2 &&
+            _signed(vertices[v][1]) >= clipY1 && _signed(vertices[v][1]) <= clipY2;
+    }
+    if (inside && numVertices <= OLED_MAX_POLYGON_VERTICES)
+        return _sendPolygon(color, numVertices, vertices);
+    if (inside)
+        return _drawPolyline(color, numVertices, vertices);
+
+    // Polygons are outlines, so a cut one is just its cut edges.
+    bool result = true;
+    for (uint8_t v = 0; v < numVertices; v++)
+    {
+        uint8_t next = (v + 1) % numVertices;
+        result = drawLine(vertices[v][0], vertices[v][1],
+            vertices[next][0], vertices[next][1], color) && result;
+    }
+    return result;
+}
+
+// Outlines with more vertices than one command takes go as chains of three edges, each sent
+// as a polygon that goes there and comes back the same way: a, b, c, d, c, b (and back to a).
+bool OLED::_drawPolyline(uint16_t color, uint8_t numVertices, uint16_t vertices[][2])
+{
+    bool result = true;
+    for (uint16_t first = 0; first < numVertices; first += 3)
+    {
+        uint8_t edges = min(numVertices - first, 3);
+        if (edges == 1)
+        {
+            uint8_t next = (first + 1) % numVertices;
+            result = _sendLine(vertices[first][0], vertices[first][1],
+                vertices[next][0], vertices[next][1], color) && result;
+            continue;
+        }
+        uint16_t chain[2 * 3][2];
+        uint8_t count = 0;
+        for (int8_t step = 0; step <= edges; step++, count++)
+        {
+            chain[count][0] = vertices[(first + step) % numVertices][0];
+            chain[count][1] = vertices[(first + step) % numVertices][1];
+        }
+        for (int8_t step = edges - 1; step > 0; step--, count++)
+        {
+            chain[count][0] = vertices[first + step][0];
+            chain[count][1] = vertices[first + step][1];
+        }
+        result = _sendPolygon(color, count, chain) && result;
+    }
+    return result;
+}
+
+bool OLED::fillPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2])
+{
+    if (numVertices < 3)
+        return drawPolygon(color, numVertices, vertices);
+
+    // Triangles take their fill from the display's setting.
+    bool wasFilled = _fillShapes;
+    if (!setFill(true))
+        return false;
+    bool result = _fillPolygon(color, numVertices, vertices);
+    if (!wasFilled)
+        result = setFill(false) && result;
+    return result;
+}
+
+bool OLED::fillPolygon(Color color, uint8_t numVertices, uint16_t vertices[][2])
+{
+    return fillPolygon(color.to16BitRGB(), numVertices, vertices);
+}
+
+// Twice the signed area of the triangle a, b, c: positive when it turns counterclockwise
+// (in screen coordinates, y down), zero when they're in a line.
+static int64_t _turn(const uint16_t *a, const uint16_t *b, const uint16_t *c)
+{
+    return (int64_t)(_signed(b[0]) - _signed(a[0])) * (_signed(a[1]) - _signed(c[1])) -
+        (int64_t)(_signed(a[1]) - _signed(b[1])) * (_signed(c[0]) - _signed(a[0]));
+}
+
+// Ear clipping: cuts off one corner at a time, each a triangle with no other vertex in it,
+// so concave polygons come out right where a fan wouldn't. Corners in a line with their
+// neighbours are dropped without drawing anything. Edges mustn't cross.
+bool OLED::_fillPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2])
+{
+    uint8_t *remaining = new uint8_t[numVertices];
+    if (!remaining)
+        return false;
+    int64_t area = 0;
+    for (uint8_t v = 0; v < numVertices; v++)
+    {
+        remaining[v] = v;
+        area += _turn(vertices[0], vertices[v], vertices[(v + 1) % numVertices]);
+    }
+
+    bool result = true;
+    uint8_t count = numVertices;
+    uint8_t corner = 0;
+    uint8_t sinceEar = 0;
+    while (count >= 3)
+    {
+        uint16_t *previous = vertices[remaining[(corner + count - 1) % count]];
+        uint16_t *current = vertices[remaining[corner]];
+        uint16_t *next = vertices[remaining[(corner + 1) % count]];
+        int64_t turn = _turn(previous, current, next);
+
+        // Convex (turning the same way as the whole polygon), with nothing else inside.
+        bool ear = turn == 0 || (turn > 0) == (area > 0);
+        for (uint8_t other = 0; other < count && ear && turn != 0; other++)
+        {
+            uint16_t *point = vertices[remaining[other]];
+            if (point == previous || point == current || point == next)
+                continue;
+            int64_t turn1 = _turn(previous, current, point);
+            int64_t turn2 = _turn(current, next, point);
+            int64_t turn3 = _turn(next, previous, point);
+            ear = !(turn > 0
+                ? turn1 >= 0 && turn2 >= 0 && turn3 >= 0
+                : turn1 <= 0 && turn2 <= 0 && turn3 <= 0);
+        }
+        // Edges that cross leave no ears; take what's left as it comes.
+        if (!ear && ++sinceEar < count)
+        {
+            corner = (corner + 1) % count;
+            continue;
+        }
+
+        if (turn != 0)
+            result = drawTriangle(previous[0], previous[1], current[0], current[1],
+                next[0], next[1], color) && result;
+        count--;
+        for (uint8_t v = corner; v < count; v++)
+            remaining[v] = remaining[v + 1];
+        corner = corner % count;
+        sinceEar = 0;
+    }
+    delete[] remaining;
+    return result;
+}
+
+bool OLED::_sendPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2])
+{
+    OLEDCommands::polygon(*this, numVertices);
+    uint16_t minX = 0xFFFF, minY = 0xFFFF, maxX = 0, maxY = 0;
     for (uint8_t v = 0; v < numVertices; v++)
-        writeSpatial(2, vertices[v][0], vertices[v][1]);
+    {
+        uint16_t x = vertices[v][0], y = vertices[v][1];
+        _toBackBuffer(x, y);
+        OLEDCommands::point(*this, x, y);
+        minX = min(minX, x);
+        minY = min(minY, y);
+        maxX = max(maxX, x);
+        maxY = max(maxY, y);
+    }
     writeShort(color);
-    return getAck();
+    // Every edge could cross the whole box.
+    _commandPixels = (uint32_t)numVertices * (maxX - minX + maxY - minY + 2);
+    bool result = getAck();
+    if (result)
+        _markShadowUnconfirmed(minX, minY, maxX, maxY);
+
+    // Polygons are always outlines.
+    for (uint8_t v = 0; v < numVertices && _shadow; v++)
+    {
+        uint8_t next = (v + 1) % numVertices;
+        uint16_t x1 = vertices[v][0] + _originX, y1 = vertices[v][1] + _originY;
+        uint16_t x2 = vertices[next][0] + _originX, y2 = vertices[next][1] + _originY;
+        if (result)
+            _shadow->drawLine(x1, y1, x2, y2, color);
+        else
+            _markShadowUnknown(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2));
+    }
+    return result;
 }
 
 bool OLED::drawPolygon(Color color, uint8_t numVertices, uint16_t vertices[][2])
@@ -784,10 +2143,47 @@ bool OLED::drawPolygon(Color color, uint8_t numVertices, uint16_t vertices[][2])
 
 bool OLED::drawCircle(uint16_t x, uint16_t y, uint16_t radius, uint16_t color)
 {
-    write(OLED_CMD_DRAW_CIRCLE);
-    writeSpatial(3, x, y, radius);
-    writeShort(color);
-    return getAck();
+    int32_t cx = _signed(x), cy = _signed(y);
+    int32_t clipX1, clipY1, clipX2, clipY2;
+    if (!_getClip(clipX1, clipY1, clipX2, clipY2) ||
+        cx + radius < clipX1 || cx - radius > clipX2 ||
+        cy + radius < clipY1 || cy - radius > clipY2)
+        return true;
+    if (cx - radius >= clipX1 && cx + radius <= clipX2 &&
+        cy - radius >= clipY1 && cy + radius <= clipY2)
+        return _sendCircle(x, y, radius, color);
+
+    // The display cuts circles at its own edges, but knows nothing of the clip rectangle
+    // and can't be given a centre it can't address.
+    uint16_t spatialMax = _controllerType == Picaso ? 0xFFFF : 0xFF;
+    // That edge is somewhere else entirely for a back buffer.
+    bool screenOnly = !_inFrame && _deviceWidth > 0 && _deviceHeight > 0 &&
+        _clipX1 == 0 && _clipY1 == 0 && _clipX2 >= _deviceWidth - 1 && _clipY2 >= _deviceHeight - 1;
+    if (screenOnly && cx >= 0 && cy >= 0 && cx <= clipX2 && cy <= clipY2 &&
+        radius <= spatialMax)
+        return _sendCircle(x, y, radius, color);
+    return _drawClippedCircle(cx, cy, radius, color);
+}
+
+bool OLED::_sendCircle(uint16_t x, uint16_t y, uint16_t radius, uint16_t color)
+{
+    _markFrameDirty((int32_t)x - radius, (int32_t)y - radius,
+        (int32_t)x + radius, (int32_t)y + radius);
+    _toBackBuffer(x, y);
+    OLEDCommands::circle(*this, x, y, radius, color);
+    _commandPixels = _getShapePixels((int32_t)x - radius, (int32_t)y - radius,
+        (int32_t)x + radius, (int32_t)y + radius);
+    if (!getAck())
+    {
+        _markShadowUnknown((int32_t)x - radius, (int32_t)y - radius,
+            (int32_t)x + radius, (int32_t)y + radius);
+        return false;
+    }
+    _markShadowUnconfirmed((int32_t)x - radius, (int32_t)y - radius,
+        (int32_t)x + radius, (int32_t)y + radius);
+    if (_shadow)
+        _shadow->drawCircle(x, y, radius, color, _fillShapes);
+    return true;
 }
 
 bool OLED::drawCircle(uint16_t x, uint16_t y, uint16_t radius, Color color)
@@ -795,50 +2191,435 @@ bool OLED::drawCircle(uint16_t x, uint16_t y, uint16_t radius, Color color)
     return drawCircle(x, y, radius, color.to16BitRGB());
 }
 
-// NOT YET IMPLEMENTED
+
+
+//
+// Double buffering
+//
+
+bool OLED::setBackBuffer(uint16_t frontX, uint16_t frontY, uint16_t width, uint16_t height,
+    uint16_t backX, uint16_t backY)
+{
+    uint16_t screenWidth = getDeviceWidth();
+    uint16_t screenHeight = getDeviceHeight();
+    // Both rectangles on the screen, and apart.
+    if (_inFrame || width < 1 || height < 1 ||
+        (uint32_t)frontX + width > screenWidth || (uint32_t)frontY + height > screenHeight ||
+        (uint32_t)backX + width > screenWidth || (uint32_t)backY + height > screenHeight ||
+        ((uint32_t)frontX < (uint32_t)backX + width && (uint32_t)backX < (uint32_t)frontX + width &&
+        (uint32_t)frontY < (uint32_t)backY + height && (uint32_t)backY < (uint32_t)frontY + height))
+        return false;
+    _frontX = frontX;
+    _frontY = frontY;
+    _frameWidth = width;
+    _frameHeight = height;
+    _backX = backX;
+    _backY = backY;
+    _hasBackBuffer = true;
+    return true;
+}
+
+void OLED::clearBackBuffer()
+{
+    if (_inFrame)
+        endFrame();
+    _hasBackBuffer = false;
+}
+
+bool OLED::beginFrame()
+{
+    if (!_hasBackBuffer || _inFrame)
+        return false;
+    // Batched pixels go where they were meant to.
+    bool result = flushPixels();
+    _inFrame = true;
+    _originX = _backX - _frontX;
+    _originY = _backY - _frontY;
+    _dirtyX1 = _dirtyY1 = 0x7FFFFFFF;
+    _dirtyX2 = _dirtyY2 = -1;
+    return result;
+}
+
+bool OLED::endFrame()
+{
+    if (!_inFrame)
+        return false;
+    bool result = flushPixels();
+    _inFrame = false;
+    _originX = 0;
+    _originY = 0;
+
+    // Text isn't clipped, but only the frame is copied.
+    int32_t x1 = max(_dirtyX1, (int32_t)_frontX);
+    int32_t y1 = max(_dirtyY1, (int32_t)_frontY);
+    int32_t x2 = min(_dirtyX2, (int32_t)_frontX + _frameWidth - 1);
+    int32_t y2 = min(_dirtyY2, (int32_t)_frontY + _frameHeight - 1);
+    if (x1 > x2 || y1 > y2)
+        return result;
+    return screenCopyPaste(_backX + (x1 - _frontX), _backY + (y1 - _frontY), x1, y1,
+        x2 - x1 + 1, y2 - y1 + 1) && result;
+}
+
+// Moves a point from the front rectangle to the back buffer, if drawing a frame, and
+// counts it as drawn.
+void OLED::_toBackBuffer(uint16_t &x, uint16_t &y)
+{
+    if (!_inFrame)
+        return;
+    _markFrameDirty(x, y, x, y);
+    x += _originX;
+    y += _originY;
+}
+
+void OLED::_markFrameDirty(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    if (!_inFrame)
+        return;
+    _dirtyX1 = min(_dirtyX1, min(x1, x2));
+    _dirtyY1 = min(_dirtyY1, min(y1, y2));
+    _dirtyX2 = max(_dirtyX2, max(x1, x2));
+    _dirtyY2 = max(_dirtyY2, max(y1, y2));
+}
+
+
+//
+// Clipping
+//
+
+void OLED::setClipRect(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    _clipX1 = min(x1, x2);
+    _clipY1 = min(y1, y2);
+    _clipX2 = max(x1, x2);
+    _clipY2 = max(y1, y2);
+}
+
+void OLED::clearClipRect()
+{
+    setClipRect(0, 0, 0xFFFF, 0xFFFF);
+}
+
+// The area shapes are cut to: the clip rectangle, the screen once its size is known, and
+// whatever a coordinate byte can address on a Goldelox (beyond that they'd wrap around).
+// False if that leaves nothing.
+bool OLED::_getClip(int32_t &x1, int32_t &y1, int32_t &x2, int32_t &y2)
+{
+    int32_t spatialMax = _controllerType == Picaso ? 0xFFFF : 0xFF;
+    x1 = _clipX1;
+    y1 = _clipY1;
+    x2 = min((int32_t)_clipX2, spatialMax);
+    y2 = min((int32_t)_clipY2, spatialMax);
+    if (_deviceWidth > 0)
+        x2 = min(x2, (int32_t)_deviceWidth - 1);
+    if (_deviceHeight > 0)
+        y2 = min(y2, (int32_t)_deviceHeight - 1);
+    if (_inFrame)
+    {
+        x1 = max(x1, (int32_t)_frontX);
+        y1 = max(y1, (int32_t)_frontY);
+        x2 = min(x2, (int32_t)_frontX + _frameWidth - 1);
+        y2 = min(y2, (int32_t)_frontY + _frameHeight - 1);
+    }
+    return x1 <= x2 && y1 <= y2;
+}
+
+// Cohen-Sutherland: false if none of the line is inside.
+bool OLED::_clipLine(int32_t &x1, int32_t &y1, int32_t &x2, int32_t &y2)
+{
+    int32_t clipX1, clipY1, clipX2, clipY2;
+    if (!_getClip(clipX1, clipY1, clipX2, clipY2))
+        return false;
+    while (true)
+    {
+        uint8_t edges1 = (x1 < clipX1 ? ClipLeft : 0) | (x1 > clipX2 ? ClipRight : 0) |
+            (y1 < clipY1 ? ClipTop : 0) | (y1 > clipY2 ? ClipBottom : 0);
+        uint8_t edges2 = (x2 < clipX1 ? ClipLeft : 0) | (x2 > clipX2 ? ClipRight : 0) |
+            (y2 < clipY1 ? ClipTop : 0) | (y2 > clipY2 ? ClipBottom : 0);
+        if (!(edges1 | edges2))
+            return true;
+        if (edges1 & edges2)
+            return false;
+
+        // Move the outside end onto the edge it's beyond.
+        uint8_t edges = edges1 ? edges1 : edges2;
+        int32_t x, y;
+        if (edges & (ClipTop | ClipBottom))
+        {
+            y = edges & ClipTop ? clipY1 : clipY2;
+            x = _interpolate(x1, x2, y - y1, y2 - y1);
+        }
+        else
+        {
+            x = edges & ClipLeft ? clipX1 : clipX2;
+            y = _interpolate(y1, y2, x - x1, x2 - x1);
+        }
+        if (edges == edges1) { x1 = x; y1 = y; }
+        else { x2 = x; y2 = y; }
+    }
+}
+
+bool OLED::_drawClippedPixel(int32_t x, int32_t y, uint16_t color)
+{
+    if (x < 0 || y < 0 || x > 0xFFFF || y > 0xFFFF)
+        return true;
+    return drawPixel(x, y, color);
+}
+
+// A filled triangle crossing the clip is cut down to a polygon (Sutherland-Hodgman), which
+// goes as a fan of triangles, since the display only draws polygon outlines.
+bool OLED::_drawClippedTriangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+    int32_t x3, int32_t y3, uint16_t color)
+{
+    int32_t clip[4];
+    _getClip(clip[0], clip[2], clip[1], clip[3]);
+
+    // Each edge can add one vertex.
+    int32_t points[2][7][2] = { { { x1, y1 }, { x2, y2 }, { x3, y3 } } };
+    uint8_t count = 3;
+    for (uint8_t edge = 0; edge < 4 && count > 0; edge++)
+    {
+        int32_t (*in)[2] = points[edge % 2];
+        int32_t (*out)[2] = points[(edge + 1) % 2];
+        uint8_t axis = edge < 2 ? 0 : 1;
+        bool lower = edge % 2 == 0;
+        uint8_t outCount = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            int32_t *current = in[i];
+            int32_t *previous = in[(i + count - 1) % count];
+            bool currentInside = lower ? current[axis] >= clip[edge] : current[axis] <= clip[edge];
+            bool previousInside = lower ? previous[axis] >= clip[edge] : previous[axis] <= clip[edge];
+            if (currentInside != previousInside)
+            {
+                int32_t *crossing = out[outCount++];
+                crossing[axis] = clip[edge];
+                crossing[1 - axis] = _interpolate(previous[1 - axis], current[1 - axis],
+                    clip[edge] - previous[axis], current[axis] - previous[axis]);
+            }
+            if (currentInside)
+            {
+                out[outCount][0] = current[0];
+                out[outCount++][1] = current[1];
+            }
+        }
+        count = outCount;
+    }
+
+    int32_t (*polygon)[2] = points[0];
+    bool result = true;
+    for (uint8_t i = 1; i + 1 < count; i++)
+    {
+        result = _sendTriangle(polygon[0][0], polygon[0][1], polygon[i][0], polygon[i][1],
+            polygon[i + 1][0], polygon[i + 1][1], color) && result;
+    }
+    return result;
+}
+
+// A circle the display can't be trusted to cut goes as clipped rows when filled (rows cut
+// to the same width merged into rectangles), or as its outline pixels, batched.
+bool OLED::_drawClippedCircle(int32_t cx, int32_t cy, int32_t radius, uint16_t color)
+{
+    bool result = true;
+    if (_fillShapes)
+    {
+        int32_t clipX1, clipY1, clipX2, clipY2;
+        _getClip(clipX1, clipY1, clipX2, clipY2);
+        uint32_t limit = (uint32_t)radius * radius + radius;
+        int32_t halfWidth = 0;
+        int32_t spanX1 = 0, spanX2 = -1, spanY1 = 0, spanY2 = 0;
+        for (int32_t y = max(cy - radius, clipY1); y <= min(cy + radius, clipY2); y++)
+        {
+            uint32_t dy = abs(y - cy);
+            while (halfWidth < radius && (uint32_t)(halfWidth + 1) * (halfWidth + 1) + dy * dy <= limit)
+                halfWidth++;
+            while (halfWidth > 0 && (uint32_t)halfWidth * halfWidth + dy * dy > limit)
+                halfWidth--;
+            int32_t x1 = max(cx - halfWidth, clipX1), x2 = min(cx + halfWidth, clipX2);
+            if (x1 == spanX1 && x2 == spanX2 && y == spanY2 + 1)
+            {
+                spanY2 = y;
+                continue;
+            }
+            if (spanX1 <= spanX2)
+                result = _sendRectangle(spanX1, spanY1, spanX2, spanY2, color) && result;
+            spanX1 = x1;
+            spanX2 = x2;
+            spanY1 = spanY2 = y;
+        }
+        if (spanX1 <= spanX2)
+            result = _sendRectangle(spanX1, spanY1, spanX2, spanY2, color) && result;
+        return result;
+    }
+
+    bool batching = _batchingPixels;
+    if (!batching)
+        beginPixels();
+    int32_t x = radius, y = 0;
+    int32_t error = 1 - radius;
+    while (x >= y)
+    {
+        result = _drawClippedPixel(cx + x, cy + y, color) && result;
+        result = _drawClippedPixel(cx - x, cy + y, color) && result;
+        result = _drawClippedPixel(cx + x, cy - y, color) && result;
+        result = _drawClippedPixel(cx - x, cy - y, color) && result;
+        result = _drawClippedPixel(cx + y, cy + x, color) && result;
+        result = _drawClippedPixel(cx - y, cy + x, color) && result;
+        result = _drawClippedPixel(cx + y, cy - x, color) && result;
+        result = _drawClippedPixel(cx - y, cy - x, color) && result;
+        y++;
+        if (error < 0)
+            error += 2 * y + 1;
+        else
+        {
+            x--;
+            error += 2 * (y - x) + 1;
+        }
+    }
+    if (!batching)
+        result = endPixels() && result;
+    return result;
+}
+
 // The width MUST match the width of the original image to display correctly.
 // Height can be anything <= original height, image will be truncated accordingly.
 bool OLED::drawImage8Bit(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
-        uint8_t pixel1, ...)
+    const uint8_t *pixels)
 {
-    return false;
-    //write(6, OLED_CMD_DRAW_IMAGE, x, y, imageWidth, imageHeight, OLED_PRM_DRAW_IMAGE_8BIT);
-    // TODO: process/send pixel data
-    //write(imageWidth*imageHeight, pixel1, ...);
-    //return getAck();
+    return _drawImage(x, y, imageWidth, imageHeight, pixels, 1, false);
 }
 
-// NOT YET IMPLEMENTED
-// The width MUST match the width of the original image to display correctly.
-// Height can be anything <= original height, image will be truncated accordingly.
 bool OLED::drawImage16Bit(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
-        uint16_t pixel1, ...)
+    const uint16_t *pixels)
 {
-    return false;
-    //write(6, OLED_CMD_DRAW_IMAGE, x, y, imageWidth, imageHeight, OLED_PRM_DRAW_IMAGE_16BIT);
-    // TODO: process/send pixel data
-    //writeShort(imageWidth*imageHeight, pixel1, ...);
-    //return getAck();
+    return _drawImage(x, y, imageWidth, imageHeight, (const uint8_t *)pixels, 2, false);
+}
+
+bool OLED::drawImage8Bit_P(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
+    const uint8_t *pixels)
+{
+    return _drawImage(x, y, imageWidth, imageHeight, pixels, 1, true);
+}
+
+bool OLED::drawImage16Bit_P(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
+    const uint16_t *pixels)
+{
+    return _drawImage(x, y, imageWidth, imageHeight, (const uint8_t *)pixels, 2, true);
+}
+
+void OLED::_writeImageHeader(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+    uint8_t bytesPerPixel)
+{
+    write(OLED_CMD_DRAW_IMAGE);
+    writeSpatial(4, x, y, width, height);
+    _commandPixels = (uint32_t)width * height;
+    write(bytesPerPixel == 2 ? OLED_PRM_DRAW_IMAGE_16BIT : OLED_PRM_DRAW_IMAGE_8BIT);
+}
+
+// Sends the image a strip of rows at a time, so no one command is too long to wait for
+// (and a Goldelox never gets a height over 255). Pixel data goes straight from the
+// source to the serial port, through the frame at most.
+bool OLED::_drawImage(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
+    const uint8_t *pixels, uint8_t bytesPerPixel, bool progmem)
+{
+    if (imageWidth < 1 || imageHeight < 1 || !pixels)
+        return false;
+    uint16_t spatialMax = _controllerType == Picaso ? 0xFFFF : 0xFF;
+    if (imageWidth > spatialMax)
+        return false;
+    _markFrameDirty(x, y, (int32_t)x + imageWidth - 1, (int32_t)y + imageHeight - 1);
+    _toBackBuffer(x, y);
+
+    uint32_t rowBytes = (uint32_t)imageWidth * bytesPerPixel;
+    uint16_t stripRows = min(max(OLED_IMAGE_STRIP_BYTES / rowBytes, (uint32_t)1),
+        (uint32_t)spatialMax);
+    for (uint16_t row = 0; row < imageHeight; row += stripRows)
+    {
+        uint16_t rows = min(stripRows, (uint16_t)(imageHeight - row));
+        uint32_t bytes = rowBytes * rows;
+        const uint8_t *strip = pixels + rowBytes * row;
+        _writeImageHeader(x, y + row, imageWidth, rows, bytesPerPixel);
+        if (bytesPerPixel == 2)
+        {
+            // Shorts go out most significant byte first, whatever order they're stored in.
+            const uint16_t *shorts = (const uint16_t *)strip;
+            for (uint32_t p = 0; p < bytes / 2; p++)
+                writeShort(progmem ? pgm_read_word(shorts + p) : shorts[p]);
+        }
+        else if (progmem)
+        {
+            for (uint32_t p = 0; p < bytes; p++)
+                write(pgm_read_byte(strip + p));
+        }
+        else
+        {
+            for (uint32_t sent = 0; sent < bytes; sent += 0xFFFF)
+                write(strip + sent, (uint16_t)min(bytes - sent, (uint32_t)0xFFFF));
+        }
+
+        if (!getAck())
+        {
+            _markShadowUnknown(x, y + row, x + imageWidth - 1, y + imageHeight - 1);
+            return false;
+        }
+        _markShadowUnconfirmed(x, y + row, x + imageWidth - 1, y + row + rows - 1);
+        for (uint32_t p = 0; p < (uint32_t)imageWidth * rows && _shadow; p++)
+        {
+            uint16_t color = bytesPerPixel == 2
+                ? (progmem ? pgm_read_word((const uint16_t *)strip + p) : ((const uint16_t *)strip)[p])
+                : Color::from8BitRGB(progmem ? pgm_read_byte(strip + p) : strip[p]).to16BitRGB();
+            _shadow->drawPixel(x + p % imageWidth, y + row + p / imageWidth, color);
+        }
+    }
+    return true;
 }
 
 bool OLED::addUserBitmap(uint8_t charIndex,
     uint8_t data1, uint8_t data2, uint8_t data3, uint8_t data4,
     uint8_t data5, uint8_t data6, uint8_t data7, uint8_t data8)
 {
-    _charIndexList[charIndex] = true;
+    if (charIndex >= OLED_MAX_USER_BITMAPS)
+        return false;
+
     write(10, OLED_CMD_ADD_USER_BITMAP, charIndex,
         data1, data2, data3, data4, data5, data6, data7, data8);
-    return getAck();
+    _charIndexList[charIndex] = getAck();
+    if (_charIndexList[charIndex] && (_pendingAcks > 0 || _asyncCommandCount > 0))
+        _unconfirmedBitmaps |= (uint32_t)1 << charIndex;
+    return _charIndexList[charIndex];
+}
+
+bool OLED::addUserBitmap(uint8_t charIndex, const uint8_t *data)
+{
+    return addUserBitmap(charIndex,
+        data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7]);
+}
+
+bool OLED::addUserBitmap_P(uint8_t charIndex, const uint8_t *data)
+{
+    uint8_t bitmap[8];
+    for (uint8_t b = 0; b < 8; b++)
+        bitmap[b] = pgm_read_byte(data + b);
+    return addUserBitmap(charIndex, bitmap);
+}
+
+bool OLED::hasUserBitmap(uint8_t charIndex)
+{
+    return charIndex < OLED_MAX_USER_BITMAPS && _charIndexList[charIndex];
 }
 
 bool OLED::drawUserBitmap(uint8_t charIndex, uint16_t x, uint16_t y, uint16_t color)
 {
-    if (!_charIndexList[charIndex])
+    if (!hasUserBitmap(charIndex))
         return false;
 
+    _markFrameDirty(x, y, (int32_t)x + 7, (int32_t)y + 7);
+    _toBackBuffer(x, y);
     write(2, OLED_CMD_DRAW_USER_BITMAP, charIndex);
     writeSpatial(2, x, y);
     writeShort(color);
+    _commandPixels = 64;
+    // The bitmap itself isn't kept here.
+    _markShadowUnknown(x, y, x + 7, y + 7);
     return getAck();
 }
 
@@ -849,25 +2630,53 @@ bool OLED::drawUserBitmap(uint8_t charIndex, uint16_t x, uint16_t y, Color color
 
 bool OLED::setFill(bool fillShapes)
 {
-    write(2, OLED_CMD_SET_SHAPE_FILL,
-        fillShapes ? OLED_PRM_SHAPE_FILL_SOLID : OLED_PRM_SHAPE_FILL_EMPTY);
-    return getAck();
+    if ((_stateKnown & StateFill) && _fillShapes == fillShapes)
+        return true;
+    OLEDCommands::fill(*this, fillShapes);
+    if (!getAck())
+        return false;
+    _fillShapes = fillShapes;
+    _stateKnown |= StateFill;
+    return true;
 }
 
 bool OLED::screenCopyPaste(uint16_t sourceX, uint16_t sourceY, uint16_t destX, uint16_t destY,
     uint16_t sourceWidth, uint16_t sourceHeight)
 {
-    write(OLED_CMD_SCREEN_COPY_PASTE);
-    writeSpatial(6, sourceX, sourceY, destX, destY, sourceWidth, sourceHeight);
-    return getAck();
+    if (_inFrame)
+    {
+        _markFrameDirty(destX, destY, (int32_t)destX + sourceWidth - 1,
+            (int32_t)destY + sourceHeight - 1);
+        sourceX += _originX;
+        sourceY += _originY;
+        destX += _originX;
+        destY += _originY;
+    }
+    OLEDCommands::copyPaste(*this, sourceX, sourceY, destX, destY, sourceWidth, sourceHeight);
+    // Read and written
+    _commandPixels = (uint32_t)sourceWidth * sourceHeight * 2;
+    if (!getAck())
+    {
+        _markShadowUnknown(destX, destY, destX + sourceWidth - 1, destY + sourceHeight - 1);
+        return false;
+    }
+    _markShadowUnconfirmed(destX, destY, destX + sourceWidth - 1, destY + sourceHeight - 1);
+    if (_shadow)
+        _shadow->copyPaste(sourceX, sourceY, destX, destY, sourceWidth, sourceHeight);
+    return true;
 }
 
 
 bool OLED::setBackground(uint16_t color)
 {
-    write(OLED_CMD_SET_BACKGROUND);
-    writeShort(color);
-    return getAck();
+    if ((_stateKnown & StateBackground) && _background == color)
+        return true;
+    OLEDCommands::background(*this, color);
+    if (!getAck())
+        return false;
+    _background = color;
+    _stateKnown |= StateBackground;
+    return true;
 }
 
 bool OLED::setBackground(Color color)
@@ -877,9 +2686,92 @@ bool OLED::setBackground(Color color)
 
 bool OLED::replaceBackground(uint16_t color)
 {
+    if (_inFrame)
+        return false;
     write(OLED_CMD_REPLACE_BACKGROUND);
     writeShort(color);
-    return getAck();
+    _commandPixels = _getScreenPixels();
+    if (!getAck())
+    {
+        _markShadowUnknown(0, 0, getDeviceWidth() - 1, getDeviceHeight() - 1);
+        return false;
+    }
+    _markShadowUnconfirmed(0, 0, getDeviceWidth() - 1, getDeviceHeight() - 1);
+    if (_shadow)
+        _shadow->replaceColor(0, 0, getDeviceWidth() - 1, getDeviceHeight() - 1,
+            _background, color);
+    _background = color;
+    return true;
+}
+
+void OLED::setShadow(OLEDShadow *shadow)
+{
+    _shadow = shadow;
+    _shadowReads = 0;
+}
+
+OLEDShadow *OLED::getShadow() { return _shadow; }
+void OLED::setShadowVerifyInterval(uint16_t interval) { _shadowVerifyInterval = interval; }
+uint16_t OLED::getShadowMismatches() { return _shadowMismatches; }
+void OLED::clearShadowMismatches() { _shadowMismatches = 0; }
+
+bool OLED::verifyShadow(uint16_t samples)
+{
+    if (!_shadow || !_shadow->isExact())
+        return false;
+    uint16_t before = _shadowMismatches;
+    for (uint16_t s = 0; s < samples; s++)
+    {
+        uint16_t x = _shadow->getX() + random(_shadow->getWidth());
+        uint16_t y = _shadow->getY() + random(_shadow->getHeight());
+        uint16_t expected, actual;
+        if (x >= getDeviceWidth() || y >= getDeviceHeight() ||
+            !_shadow->getPixel(x, y, expected))
+            continue;
+        if (!_checkShadowPixel(x, y, expected, actual))
+            return false;
+    }
+    return _shadowMismatches == before;
+}
+
+// Whatever the display drew there (or didn't) can't be worked out here.
+void OLED::_markShadowUnknown(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    if (_shadow)
+        _shadow->markUnknown(x1, y1, x2, y2);
+}
+
+// Called before mirroring the command just sent. If its ACK is still outstanding,
+// remember where, in case it turns out not to have been drawn.
+void OLED::_markShadowUnconfirmed(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    if (_pendingAcks == 0 && _asyncCommandCount == 0)
+        return;
+    if (_unconfirmedX1 > _unconfirmedX2)
+    {
+        _unconfirmedX1 = x1;
+        _unconfirmedY1 = y1;
+        _unconfirmedX2 = x2;
+        _unconfirmedY2 = y2;
+        return;
+    }
+    _unconfirmedX1 = min(_unconfirmedX1, x1);
+    _unconfirmedY1 = min(_unconfirmedY1, y1);
+    _unconfirmedX2 = max(_unconfirmedX2, x2);
+    _unconfirmedY2 = max(_unconfirmedY2, y2);
+}
+
+// Called as each outstanding ACK comes in (or doesn't). ACKs don't say which command
+// they belong to closely enough to undo one, so a failure writes off the whole area.
+void OLED::_resolveShadow(bool success)
+{
+    if (!success && _unconfirmedX1 <= _unconfirmedX2)
+        _markShadowUnknown(_unconfirmedX1, _unconfirmedY1, _unconfirmedX2, _unconfirmedY2);
+    if (!success || (_pendingAcks == 0 && _asyncCommandCount == 0))
+    {
+        _unconfirmedX1 = 1;
+        _unconfirmedX2 = 0;
+    }
 }
 
 bool OLED::replaceBackground(Color color)
@@ -901,18 +2793,38 @@ bool OLED::setFont(uint8_t fontSize)
             (_controllerType == Goldelox ||
             fontSize != OLED_FONT_EXTRA_LARGE))
         return false;
+    if ((_stateKnown & StateFont) && _fontSize == fontSize)
+        return true;
     write(2, OLED_CMD_SET_FONT, fontSize);
     bool result = getAck();
-    if (result) _fontSize = fontSize;
+    if (result)
+    {
+        _fontSize = fontSize;
+        _stateKnown |= StateFont;
+    }
+    return result;
+}
+
+bool OLED::setFontOpacity(bool opaque)
+{
+    bool result = _applyFontOpacity(opaque);
+    if (result) _fontOpacity = opaque;
     return result;
 }
 
-bool OLED::setFontOpacity(bool opaque)
+// Text commands take their opacity from the display, so each one makes sure it's right
+// first. Nothing is put back afterwards: the next text command does the same.
+bool OLED::_applyFontOpacity(bool opaque)
 {
-    uint8_t opacity = opaque ? OLED_FONT_OPAQUE : OLED_FONT_TRANSPARENT;
-    write(2, OLED_CMD_SET_FONT_OPACITY, opacity);
+    if ((_stateKnown & StateFontOpacity) && _deviceFontOpacity == opaque)
+        return true;
+    write(2, OLED_CMD_SET_FONT_OPACITY, opaque ? OLED_FONT_OPAQUE : OLED_FONT_TRANSPARENT);
     bool result = getAck();
-    if (result) _fontOpacity = opacity;
+    if (result)
+    {
+        _deviceFontOpacity = opaque;
+        _stateKnown |= StateFontOpacity;
+    }
     return result;
 }
 
@@ -956,9 +2868,43 @@ void OLED::setFontProportional(bool proportional)
     _fontProportional = proportional;
 }
 
+uint8_t OLED::getFontWidth(uint8_t fontSize)
+{
+    if (fontSize == OLED_FONT_SIZE_NOT_SET)
+        fontSize = _fontSize;
+    switch (fontSize)
+    {
+    case OLED_FONT_MEDIUM:
+    case OLED_FONT_LARGE:
+        return 8;
+    case OLED_FONT_EXTRA_LARGE:
+        return 12;
+    case OLED_FONT_SMALL:
+    default:
+        return 6;
+    }
+}
 
-bool OLED::drawText(uint8_t col, uint8_t row, String text, uint16_t color,
-    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+uint8_t OLED::getFontHeight(uint8_t fontSize)
+{
+    if (fontSize == OLED_FONT_SIZE_NOT_SET)
+        fontSize = _fontSize;
+    switch (fontSize)
+    {
+    case OLED_FONT_LARGE:
+        return 12;
+    case OLED_FONT_EXTRA_LARGE:
+        return 16;
+    case OLED_FONT_MEDIUM:
+    case OLED_FONT_SMALL:
+    default:
+        return 8;
+    }
+}
+
+
+bool OLED::_drawText(uint8_t col, uint8_t row, const char *text, uint16_t length, bool progmem,
+    uint16_t color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
 {
     if (!_checkDrawTextParameters(fontSize, opacity, proportional))
         return false;
@@ -970,39 +2916,35 @@ bool OLED::drawText(uint8_t col, uint8_t row, String text, uint16_t color,
         proportional = _fontProportional
             ? OLED_FONT_PROPORTIONAL : OLED_FONT_NONPROPORTIONAL;
 
-    uint8_t oldOpacity = _fontOpacity;
-    if (opacity != OLED_FONT_OPACITY_NOT_SET)
-        setFontOpacity(opacity == OLED_FONT_OPAQUE);
-    
+    _applyFontOpacity(opacity == OLED_FONT_OPACITY_NOT_SET
+        ? _fontOpacity : opacity == OLED_FONT_OPAQUE);
+    length = _getTextLength(text, length, progmem);
+    if (_inFrame)
+    {
+        _markFrameDirty((int32_t)col * getFontWidth(fontSize), (int32_t)row * getFontHeight(fontSize),
+            (int32_t)(col + length) * getFontWidth(fontSize) - 1,
+            (int32_t)(row + 1) * getFontHeight(fontSize) - 1);
+        col += _originX / getFontWidth(fontSize);
+        row += _originY / getFontHeight(fontSize);
+    }
+
     bool result;
     write(4, OLED_CMD_DRAW_STRING_TEXT, col, row, fontSize | proportional);
     writeShort(color);
-    writeString(text);
+    _writeText(text, length, progmem);
     write(0x00);
+    _commandPixels = (uint32_t)length * getFontWidth(fontSize) * getFontHeight(fontSize);
     result = getAck();
-    
-    if (opacity != OLED_FONT_OPACITY_NOT_SET)
-        setFontOpacity(oldOpacity == OLED_FONT_OPAQUE);
+    _markShadowUnknown((int32_t)col * getFontWidth(fontSize), (int32_t)row * getFontHeight(fontSize),
+        (int32_t)(col + length) * getFontWidth(fontSize) - 1,
+        (int32_t)(row + 1) * getFontHeight(fontSize) - 1);
 
     return result;
 }
 
-bool OLED::drawText(uint8_t col, uint8_t row, String text, Color color,
+bool OLED::_drawTextGraphic(uint16_t x, uint16_t y, const char *text, uint16_t length,
+    bool progmem, uint8_t width, uint8_t height, uint16_t color,
     uint8_t fontSize, uint8_t opacity, uint8_t proportional)
-{
-    return drawText(col, row, text, color.to16BitRGB(),
-        fontSize, opacity, proportional);
-}
-
-bool OLED::drawText(uint8_t col, uint8_t row, String text)
-{
-    return drawText(col, row, text, _fontColor,
-        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
-}
-
-
-bool OLED::drawTextGraphic(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height,
-    uint16_t color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
 {
     if (!_checkDrawTextParameters(fontSize, opacity, proportional) ||
         width < 1 || height < 1)
@@ -1015,9 +2957,12 @@ bool OLED::drawTextGraphic(uint16_t x, uint16_t y, String text, uint8_t width, u
         proportional = _fontProportional
             ? OLED_FONT_PROPORTIONAL : OLED_FONT_NONPROPORTIONAL;
 
-    uint8_t oldOpacity = _fontOpacity;
-    if (opacity != OLED_FONT_OPACITY_NOT_SET)
-        setFontOpacity(opacity == OLED_FONT_OPAQUE);
+    _applyFontOpacity(opacity == OLED_FONT_OPACITY_NOT_SET
+        ? _fontOpacity : opacity == OLED_FONT_OPAQUE);
+    length = _getTextLength(text, length, progmem);
+    _markFrameDirty(x, y, x + (int32_t)length * getFontWidth(fontSize) * width - 1,
+        y + (int32_t)getFontHeight(fontSize) * height - 1);
+    _toBackBuffer(x, y);
 
     bool result;
     write(OLED_CMD_DRAW_STRING_GFX);
@@ -1025,37 +2970,20 @@ bool OLED::drawTextGraphic(uint16_t x, uint16_t y, String text, uint8_t width, u
     write(fontSize | proportional);
     writeShort(color);
     write(2, width, height);
-    writeString(text);
+    _writeText(text, length, progmem);
     write(0x00);
+    _commandPixels = (uint32_t)length * getFontWidth(fontSize) * getFontHeight(fontSize) *
+        width * height;
     result = getAck();
-    
-    if (opacity != OLED_FONT_OPACITY_NOT_SET)
-        setFontOpacity(oldOpacity == OLED_FONT_OPAQUE);
+    _markShadowUnknown(x, y, x + (int32_t)length * getFontWidth(fontSize) * width - 1,
+        y + (int32_t)getFontHeight(fontSize) * height - 1);
 
     return result;
 }
 
-bool OLED::drawTextGraphic(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height,
-    Color color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
-{
-    return drawTextGraphic(x,y,text,width,height,color.to16BitRGB(),fontSize,opacity,proportional);
-}
-
-bool OLED::drawTextGraphic(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height)
-{
-    return drawTextGraphic(x, y, text, width, height, _fontColor,
-        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
-}
-
-bool OLED::drawTextGraphic(uint16_t x, uint16_t y, String text)
-{
-    return drawTextGraphic(x, y, text, 1, 1);
-}
-
-
-bool OLED::drawTextButton(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height,
-    bool pressed, uint16_t fontColor, uint16_t buttonColor,
-    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+bool OLED::_drawTextButton(uint16_t x, uint16_t y, const char *text, uint16_t length,
+    bool progmem, uint8_t width, uint8_t height, bool pressed, uint16_t fontColor,
+    uint16_t buttonColor, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
 {
     if (!_checkDrawTextParameters(fontSize, opacity, proportional) ||
         width < 1 || height < 1)
@@ -1068,18 +2996,12 @@ bool OLED::drawTextButton(uint16_t x, uint16_t y, String text, uint8_t width, ui
         proportional = _fontProportional
             ? OLED_FONT_PROPORTIONAL : OLED_FONT_NONPROPORTIONAL;
 
-    uint8_t oldOpacity = _buttonOpacity;
-    if (opacity != OLED_FONT_OPACITY_NOT_SET)
-        setButtonOpacity(opacity == OLED_FONT_OPAQUE);
-
-    bool changedFontOpacity = false;
-    uint8_t oldFontOpacity = _fontOpacity;
-    if (_buttonOpacity != _fontOpacity)
-    {
-        changedFontOpacity = true;
-        oldFontOpacity = _fontOpacity;
-        setFontOpacity(_buttonOpacity == OLED_FONT_OPAQUE);
-    }
+    _applyFontOpacity(opacity == OLED_FONT_OPACITY_NOT_SET
+        ? _buttonOpacity : opacity == OLED_FONT_OPAQUE);
+    length = _getTextLength(text, length, progmem);
+    _markFrameDirty(x, y, x + (int32_t)length * getFontWidth(fontSize) * width + 3,
+        y + (int32_t)getFontHeight(fontSize) * height + 3);
+    _toBackBuffer(x, y);
 
     bool result;
     write(2, OLED_CMD_DRAW_STRING_BUTTON,
@@ -1089,35 +3011,241 @@ bool OLED::drawTextButton(uint16_t x, uint16_t y, String text, uint8_t width, ui
     write(fontSize | proportional);
     writeShort(fontColor);
     write(2, width, height);
-    writeString(text);
+    _writeText(text, length, progmem);
     write(0x00);
+    _commandPixels = ((uint32_t)length * getFontWidth(fontSize) * width + 4) *
+        ((uint32_t)getFontHeight(fontSize) * height + 4);
     result = getAck();
-
-    if (changedFontOpacity)
-        setFontOpacity(oldFontOpacity);
-    
-    if (opacity != OLED_FONT_OPACITY_NOT_SET)
-        setButtonOpacity(oldOpacity == OLED_FONT_OPAQUE);
+    // Text plus a border of a few pixels
+    _markShadowUnknown(x, y, x + (int32_t)length * getFontWidth(fontSize) * width + 3,
+        y + (int32_t)getFontHeight(fontSize) * height + 3);
 
     return result;
 }
 
-bool OLED::drawTextButton(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height,
+bool OLED::drawText(uint8_t col, uint8_t row, const String &text, uint16_t color,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawText(col, row, text.c_str(), text.length(), false, color, fontSize, opacity, proportional);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const String &text, Color color,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawText(col, row, text.c_str(), text.length(), false, color.to16BitRGB(), fontSize, opacity, proportional);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const String &text)
+{
+    return _drawText(col, row, text.c_str(), text.length(), false, _fontColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height,
+    uint16_t color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextGraphic(x, y, text.c_str(), text.length(), false, width, height, color,
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height,
+    Color color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextGraphic(x, y, text.c_str(), text.length(), false, width, height, color.to16BitRGB(),
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height)
+{
+    return _drawTextGraphic(x, y, text.c_str(), text.length(), false, width, height, _fontColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const String &text)
+{
+    return drawTextGraphic(x, y, text, 1, 1);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height,
+    bool pressed, uint16_t fontColor, uint16_t buttonColor,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextButton(x, y, text.c_str(), text.length(), false, width, height, pressed, fontColor, buttonColor,
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height,
+    bool pressed, Color fontColor, Color buttonColor,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextButton(x, y, text.c_str(), text.length(), false, width, height,
+        pressed, fontColor.to16BitRGB(), buttonColor.to16BitRGB(),
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height,
+    bool pressed)
+{
+    return _drawTextButton(x, y, text.c_str(), text.length(), false, width, height, pressed, _fontColor, _buttonColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const char *text, uint16_t color,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawText(col, row, text, 0xFFFF, false, color, fontSize, opacity, proportional);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const char *text, Color color,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawText(col, row, text, 0xFFFF, false, color.to16BitRGB(), fontSize, opacity, proportional);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const char *text)
+{
+    return _drawText(col, row, text, 0xFFFF, false, _fontColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height,
+    uint16_t color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextGraphic(x, y, text, 0xFFFF, false, width, height, color,
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height,
+    Color color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextGraphic(x, y, text, 0xFFFF, false, width, height, color.to16BitRGB(),
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height)
+{
+    return _drawTextGraphic(x, y, text, 0xFFFF, false, width, height, _fontColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const char *text)
+{
+    return drawTextGraphic(x, y, text, 1, 1);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height,
+    bool pressed, uint16_t fontColor, uint16_t buttonColor,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextButton(x, y, text, 0xFFFF, false, width, height, pressed, fontColor, buttonColor,
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height,
+    bool pressed, Color fontColor, Color buttonColor,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextButton(x, y, text, 0xFFFF, false, width, height,
+        pressed, fontColor.to16BitRGB(), buttonColor.to16BitRGB(),
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height,
+    bool pressed)
+{
+    return _drawTextButton(x, y, text, 0xFFFF, false, width, height, pressed, _fontColor, _buttonColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const __FlashStringHelper *text, uint16_t color,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawText(col, row, (const char *)text, 0xFFFF, true, color, fontSize, opacity, proportional);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const __FlashStringHelper *text, Color color,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawText(col, row, (const char *)text, 0xFFFF, true, color.to16BitRGB(), fontSize, opacity, proportional);
+}
+
+bool OLED::drawText(uint8_t col, uint8_t row, const __FlashStringHelper *text)
+{
+    return _drawText(col, row, (const char *)text, 0xFFFF, true, _fontColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text, uint8_t width, uint8_t height,
+    uint16_t color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextGraphic(x, y, (const char *)text, 0xFFFF, true, width, height, color,
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text, uint8_t width, uint8_t height,
+    Color color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextGraphic(x, y, (const char *)text, 0xFFFF, true, width, height, color.to16BitRGB(),
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text, uint8_t width, uint8_t height)
+{
+    return _drawTextGraphic(x, y, (const char *)text, 0xFFFF, true, width, height, _fontColor,
+        OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
+}
+
+bool OLED::drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text)
+{
+    return drawTextGraphic(x, y, text, 1, 1);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const __FlashStringHelper *text, uint8_t width, uint8_t height,
+    bool pressed, uint16_t fontColor, uint16_t buttonColor,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextButton(x, y, (const char *)text, 0xFFFF, true, width, height, pressed, fontColor, buttonColor,
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const __FlashStringHelper *text, uint8_t width, uint8_t height,
     bool pressed, Color fontColor, Color buttonColor,
     uint8_t fontSize, uint8_t opacity, uint8_t proportional)
 {
-    return drawTextButton(x, y, text, width, height,
+    return _drawTextButton(x, y, (const char *)text, 0xFFFF, true, width, height,
         pressed, fontColor.to16BitRGB(), buttonColor.to16BitRGB(),
         fontSize, opacity, proportional);
 }
 
-bool OLED::drawTextButton(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height,
+bool OLED::drawTextButton(uint16_t x, uint16_t y, const __FlashStringHelper *text, uint8_t width, uint8_t height,
     bool pressed)
 {
-    return drawTextButton(x, y, text, width, height, pressed, _fontColor, _buttonColor,
+    return _drawTextButton(x, y, (const char *)text, 0xFFFF, true, width, height, pressed, _fontColor, _buttonColor,
         OLED_FONT_SIZE_NOT_SET, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_PROPORTIONAL_NOT_SET);
 }
 
+bool OLED::drawTextN(uint8_t col, uint8_t row, const char *text, uint16_t length,
+    uint16_t color, uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawText(col, row, text, length, false, color, fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextGraphicN(uint16_t x, uint16_t y, const char *text, uint16_t length,
+    uint8_t width, uint8_t height, uint16_t color,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextGraphic(x, y, text, length, false, width, height, color,
+        fontSize, opacity, proportional);
+}
+
+bool OLED::drawTextButtonN(uint16_t x, uint16_t y, const char *text, uint16_t length,
+    uint8_t width, uint8_t height, bool pressed, uint16_t fontColor, uint16_t buttonColor,
+    uint8_t fontSize, uint8_t opacity, uint8_t proportional)
+{
+    return _drawTextButton(x, y, text, length, false, width, height, pressed,
+        fontColor, buttonColor, fontSize, opacity, proportional);
+}
+
 
 bool OLED::_checkDrawTextParameters(uint8_t fontSize, uint8_t opacity, uint8_t proportional)
 {
@@ -1308,20 +3436,32 @@ bool OLED::SDWriteLong(uint16_t numValues, uint32_t value1, ...)
     return true;
 }
 
-bool OLED::SDWriteText(char* text)
+bool OLED::SDWriteText(const char *text)
 {
-    for(uint8_t c = 0; c < strlen(text); c++)
-        if (!SDWrite(text[c]))
-            return false;
-    return SDWrite(0x00);
+    return _SDWriteText(text, 0xFFFF, false);
+}
+
+bool OLED::SDWriteText(const __FlashStringHelper *text)
+{
+    return _SDWriteText((const char *)text, 0xFFFF, true);
 }
 
-bool OLED::SDWriteString(String text)
+bool OLED::SDWriteString(const String &text)
 {
-    for(uint8_t c = 0; c < text.length(); c++)
-        if (!SDWrite(text[c]))
+    return _SDWriteText(text.c_str(), text.length(), false);
+}
+
+bool OLED::_SDWriteText(const char *text, uint16_t length, bool progmem)
+{
+    for (uint16_t c = 0; c < length; c++)
+    {
+        char character = progmem ? pgm_read_byte(text + c) : text[c];
+        if (character == 0x00)
+            break;
+        if (!SDWrite((uint8_t)character))
             return false;
-    return SDWrite(0x00);
+    }
+    return SDWrite((uint8_t)0x00);
 }
 
 
@@ -1337,7 +3477,8 @@ bool OLED::SDReadSector(uint32_t sectorAddress, uint8_t *data, uint16_t &bytesRe
         OLEDUtil::getByte(sectorAddress, 2),
         OLEDUtil::getByte(sectorAddress, 1),
         OLEDUtil::getByte(sectorAddress));
-
+    // Get the command out before giving the card its head start
+    sendFrame();
     delay(OLED_SD_SECTOR_READ_DELAY_MS);
 
     for (uint16_t b = 0; b < OLED_SD_SECTOR_SIZE; b++)
@@ -1359,8 +3500,7 @@ bool OLED::SDWriteSector(uint32_t sectorAddress, uint8_t *data)
         OLEDUtil::getByte(sectorAddress, 1),
         OLEDUtil::getByte(sectorAddress));
 
-    for (uint16_t b = 0; b < OLED_SD_SECTOR_SIZE; b++)
-        write(data[b]);
+    write(data, OLED_SD_SECTOR_SIZE);
 
     return getAck();
 }
@@ -1382,50 +3522,77 @@ bool OLED::SDWipeSectors(uint32_t sectorAddress, uint32_t numSectors,
     uint32_t &sectorsWiped, bool displayProgress, uint8_t wipeData)
 {    
     sectorsWiped = 0;
-    uint32_t percent = 0;
 
     if (numSectors == 0)
         return true;
 
-    uint16_t height = getDeviceHeight();
-    uint16_t width = getDeviceWidth();
+    // The bar along the bottom is drawn empty once, then only draws what it gained; the
+    // label above it is drawn with the first sector and a few times a second after that.
+    uint16_t filled = 0;
+    uint32_t labelTime = millis();
+    if (displayProgress)
+        drawRectangleWH(0, getDeviceHeight() - 9, getDeviceWidth(), 9,
+            OLED_PROGRESSBAR_COLOR_BACK_DEFAULT);
 
     bool success = true;
-    for (uint32_t sector = sectorAddress; sector < numSectors; sector++)
+    for (uint32_t sector = sectorAddress; sector - sectorAddress < numSectors; sector++)
     {
         if (displayProgress)
         {
-
-            percent = sector * 100 / numSectors;
-            
-            drawProgressBar(0, height-9, width, 9, percent,
-                OLED_PROGRESSBAR_COLOR_FORE_DEFAULT,
-                OLED_PROGRESSBAR_COLOR_BACK_DEFAULT);
-            
-            String output = "s:" + (String)sector + " (" + percent + "%)";
-            drawTextGraphic(1, height-8, output, 1, 1,
-                OLED_FONT_COLOR_DEFAULT,
-                OLED_FONT_SMALL, OLED_FONT_TRANSPARENT, OLED_FONT_PROPORTIONAL);
+            bool labelDue = sector == sectorAddress ||
+                millis() - labelTime >= OLED_PROGRESS_LABEL_INTERVAL_MS;
+            if (labelDue)
+                labelTime = millis();
+            _drawWipeProgress(filled, sector, sector - sectorAddress, numSectors, labelDue);
         }
-        
+
         if (!SDWipeSector(sector, wipeData))
         {
             success = false;
             break;
         }
-        
+
         sectorsWiped = (sector - sectorAddress) + 1;
     }
-    
+
     if (displayProgress && success)
+        _drawWipeProgress(filled, sectorsWiped, 1, 1, true);
+
+    return success;
+}
+
+// Extends the bar from `filled` to done/total of the width and, if asked, draws the label
+// opaque and padded out so it covers the last one.
+bool OLED::_drawWipeProgress(uint16_t &filled, uint32_t sector, uint32_t done, uint32_t total,
+    bool label)
+{
+    uint16_t height = getDeviceHeight();
+    uint16_t width = getDeviceWidth();
+    // Keep width * done inside 32 bits, as OLEDProgressBar does.
+    while (total > 0xFFFF)
     {
-        drawRectangleWH(0, height-9, width, 9, OLED_PROGRESSBAR_COLOR_FORE_DEFAULT);
-        drawTextGraphic(1, height-8, "s:"+(String)sectorsWiped+" (100%)", 1, 1,
-            OLED_FONT_COLOR_DEFAULT,
-            OLED_FONT_SMALL, OLED_FONT_TRANSPARENT, OLED_FONT_PROPORTIONAL);
+        done >>= 1;
+        total >>= 1;
     }
+    uint16_t fill = (uint32_t)width * done / total;
 
-    return success;
+    bool result = true;
+    if (fill > filled)
+    {
+        result = drawRectangleWH(filled, height - 9, fill - filled, 9,
+            OLED_PROGRESSBAR_COLOR_FORE_DEFAULT) && result;
+        filled = fill;
+    }
+    if (!label)
+        return result;
+
+    uint8_t columns = min(width / getFontWidth(OLED_FONT_SMALL), 24);
+    String text = "s:" + (String)sector + " (" + (done * 100 / total) + "%)";
+    while (text.length() < columns)
+        text += ' ';
+    return drawTextN(0, (height - 9) / getFontHeight(OLED_FONT_SMALL) - 1, text.c_str(),
+        columns, OLED_FONT_COLOR_DEFAULT.to16BitRGB(), OLED_FONT_SMALL,
+        OLED_FONT_OPAQUE, OLED_FONT_NONPROPORTIONAL) && result;
 }
 
 /* // This simply takes too long to complete, so there's no point in it being here.
@@ -1467,6 +3634,47 @@ bool OLED::SDWriteScreen(uint32_t sectorAddress)
     return SDWriteScreen(sectorAddress, 0, 0, getDeviceWidth(), getDeviceHeight());
 }
 
+bool OLED::SDWriteImage(uint32_t sectorAddress, uint16_t width, uint16_t height,
+    const uint16_t *pixels)
+{
+    return _SDWriteImage(sectorAddress, width, height, pixels, false);
+}
+
+bool OLED::SDWriteImage_P(uint32_t sectorAddress, uint16_t width, uint16_t height,
+    const uint16_t *pixels)
+{
+    return _SDWriteImage(sectorAddress, width, height, pixels, true);
+}
+
+uint32_t OLED::SDGetImageSectors(uint16_t width, uint16_t height)
+{
+    return ((uint32_t)width * height * 2 + OLED_SD_SECTOR_SIZE - 1) / OLED_SD_SECTOR_SIZE;
+}
+
+bool OLED::_SDWriteImage(uint32_t sectorAddress, uint16_t width, uint16_t height,
+    const uint16_t *pixels, bool progmem)
+{
+    uint32_t pixelCount = (uint32_t)width * height;
+    for (uint32_t first = 0; first < pixelCount; first += OLED_SD_SECTOR_SIZE / 2, sectorAddress++)
+    {
+        write(5, OLED_CMD_EXTENDED_SD, OLED_CMD_SD_WRITE_SECTOR_BLOCK,
+            OLEDUtil::getByte(sectorAddress, 2),
+            OLEDUtil::getByte(sectorAddress, 1),
+            OLEDUtil::getByte(sectorAddress));
+        for (uint16_t p = 0; p < OLED_SD_SECTOR_SIZE / 2; p++)
+        {
+            uint32_t index = first + p;
+            if (index >= pixelCount)
+                writeShort(0x0000);
+            else
+                writeShort(progmem ? pgm_read_word(pixels + index) : pixels[index]);
+        }
+        if (!getAck())
+            return false;
+    }
+    return true;
+}
+
  bool OLED::SDDrawScreen(uint32_t sectorAddress)
  {
      return SDDrawImage(sectorAddress, 0, 0, getDeviceWidth(), getDeviceHeight());
@@ -1477,12 +3685,16 @@ bool OLED::SDWriteScreen(uint32_t sectorAddress)
 bool OLED::SDDrawImage(uint32_t sectorAddress,
     uint16_t x, uint16_t y, uint16_t width, uint16_t height)
 {
+    _markFrameDirty(x, y, (int32_t)x + width - 1, (int32_t)y + height - 1);
+    _toBackBuffer(x, y);
     write(2, OLED_CMD_EXTENDED_SD, OLED_CMD_SD_DISPLAY_IMAGE);
     writeSpatial(4, x, y, width, height);
     write(4, OLED_PRM_DRAW_IMAGE_16BIT,
         OLEDUtil::getByte(sectorAddress, 2),
         OLEDUtil::getByte(sectorAddress, 1),
         OLEDUtil::getByte(sectorAddress));
+    _commandPixels = (uint32_t)width * height;
+    _markShadowUnknown(x, y, (int32_t)x + width - 1, (int32_t)y + height - 1);
     return getAck();
 }
 
@@ -1490,6 +3702,9 @@ bool OLED::SDRunCommand(uint32_t address)
 {
     write(2, OLED_CMD_EXTENDED_SD, OLED_CMD_SD_DISPLAY_OBJECT);
     writeLong(address);
+    // Could be any command at all
+    _markShadowUnknown(0, 0, getDeviceWidth() - 1, getDeviceHeight() - 1);
+    invalidateState();
     return getAck();
 }
 
@@ -1497,6 +3712,8 @@ bool OLED::SDRunCommand(uint32_t address)
 bool OLED::SDPlayVideo(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
     uint8_t delayMs, uint16_t frameCount, uint32_t sectorAddress)
 {
+    _markFrameDirty(x, y, (int32_t)x + width - 1, (int32_t)y + height - 1);
+    _toBackBuffer(x, y);
     write(2, OLED_CMD_EXTENDED_SD, OLED_CMD_SD_DISPLAY_VIDEO);
     writeSpatial(4, x, y, width, height);
     write(2, OLED_PRM_DRAW_IMAGE_16BIT, delayMs);
@@ -1505,6 +3722,7 @@ bool OLED::SDPlayVideo(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
         OLEDUtil::getByte(sectorAddress, 2),
         OLEDUtil::getByte(sectorAddress, 1),
         OLEDUtil::getByte(sectorAddress));
+    _markShadowUnknown(x, y, (int32_t)x + width - 1, (int32_t)y + height - 1);
     return getAck();
 }
 
@@ -1513,6 +3731,8 @@ bool OLED::SDRunScript(uint32_t address)
 {
     write(2, OLED_CMD_EXTENDED_SD, OLED_CMD_SD_RUN_4DSL_SCRIPT);
     writeLong(address);
+    _markShadowUnknown(0, 0, getDeviceWidth() - 1, getDeviceHeight() - 1);
+    invalidateState();
 
     // This command will not return a response if successful.
     // If unsuccessful (or no SD is installed), NAK is returned.
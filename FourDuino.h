@@ -7,6 +7,8 @@
 #include "OLEDUtil.h"
 #include "Color.h"
 #include "SerialContainers.h"
+#include "OLEDTelemetry.h"
+#include "OLEDShadow.h"
 
 //
 // Settings
@@ -16,11 +18,34 @@
 #define OLED_HARDWARE_SERIAL_DEFAULT    Serial  // Mega can also use Serial1, Serial2, Serial3
 #define OLED_BAUD_DEFAULT               9600    // 38400+ causes problems with ReadSector using SoftwareSerial
 #define OLED_INIT_RETRIES               10      // How many times to try initializing before failing
+#define OLED_BAUD_NEGOTIATE_MAX_DEFAULT 115200  // Fastest rate init(true) will try
+#define OLED_BAUD_VERIFY_PASSES         3       // Round trips a negotiated rate must survive
+#define OLED_BAUD_VERIFY_SECTOR         0       // SD sector read back to verify a rate, if a card is present
+#define OLED_BAUD_FALLBACK_ERRORS       3       // Consecutive timeouts/garbled responses before stepping a negotiated rate down
 #define OLED_INIT_DELAY_MS              1000    // How long to wait for the display to power up
 #define OLED_RESET_DELAY_MS             20      // How long to hold reset pin low
 #define OLED_RESPONSE_RETRY_DELAY_US    17      // 17.3: Approximate amount of time for one bit at 57600
 #define OLED_RESPONSE_RETRIES           30000   // 60000: About one second at 17 microseconds per retry
+// Response timeouts are worked out per command from the baud rate, the bytes still on the wire
+// and an execution time estimate for the command, which adapts to what the display actually does.
+// The fixed budget above is now only the upper limit for any single wait.
+#define OLED_RESPONSE_TIMEOUT_MAX_US    ((uint32_t)OLED_RESPONSE_RETRIES * OLED_RESPONSE_RETRY_DELAY_US)
+#define OLED_RESPONSE_TIMEOUT_MARGIN    2       // Multiple of the expected execution time to wait
+#define OLED_RESPONSE_TIMEOUT_SLACK_US  1000    // Added to every timeout to cover scheduling jitter
+#define OLED_RESPONSE_PIXEL_NS          2000    // Worst case per pixel a command fills, copies or clears
 #define OLED_SD_SECTOR_READ_DELAY_MS    0       // Slow SD cards might want to increase this to prevent underflow
+#define OLED_FRAME_BUFFER_SIZE          32      // Command bytes collected before being sent in one write
+#define OLED_PIPELINE_DEPTH_DEFAULT     1       // Commands allowed in flight; 1 waits for every ACK
+#define OLED_ASYNC_QUEUE_BYTES          128     // Command bytes that can be queued in asynchronous mode
+#define OLED_ASYNC_QUEUE_COMMANDS       16      // Commands that can be queued in asynchronous mode
+#define OLED_ASYNC_POLL_BYTES           8       // Most bytes poll() will transmit per call
+#define OLED_PIXEL_BATCH_SIZE           32      // Pixels beginPixels() collects before sending (7 bytes each)
+#define OLED_PIXEL_BATCH_COMMAND_COST   8       // Overhead of each command (ACK and turnaround) in bytes, for batching
+#define OLED_IMAGE_STRIP_BYTES          2048    // Most pixel data in one image command; bigger images go in strips
+#define OLED_PROGRESS_LABEL_INTERVAL_MS 250     // Shortest time between progress bar label redraws
+#ifndef OLED_TELEMETRY
+#define OLED_TELEMETRY                  0       // 1 to keep per-command transport statistics (~1KB SRAM)
+#endif
 // Removed as part of the SD-wipe removal.
 // #define OLED_SD_WIPE_MAX_SECTORS        0xFFFFFFFF  // Dunno how big these things get, really.
 
@@ -194,6 +219,9 @@
 #define OLED_SD_READ_STRING_MAX_LENGTH      2048
 
 
+// Called from poll() when a queued command is ACKed, NAKed or times out.
+typedef void (*OLEDCommandCallback)(uint16_t handle, bool success);
+
 class OLED
 {
 public:
@@ -204,29 +232,93 @@ public:
         uint32_t baudRate = OLED_BAUD_DEFAULT, uint16_t initDelay = OLED_INIT_DELAY_MS);
     OLED(uint8_t pinReset, SoftwareSerial serial,
         uint32_t baudRate = OLED_BAUD_DEFAULT, uint16_t initDelay = OLED_INIT_DELAY_MS);
+    // Any other transport, e.g. PosixSerialContainer. The caller keeps ownership of it.
+    OLED(uint8_t pinReset, SerialContainer *serial,
+        uint32_t baudRate = OLED_BAUD_DEFAULT, uint16_t initDelay = OLED_INIT_DELAY_MS);
     ~OLED();
     
     void write(uint8_t value);
     void write(uint8_t numValues, uint8_t value1, ...);
+    void write(const uint8_t *values, uint16_t numValues);
     void writeShort(uint16_t value);
     void writeShort(uint8_t numValues, uint16_t value1, ...);
     void writeLong(uint32_t value);
     void writeLong(uint8_t numValues, uint32_t value1, ...);
-    void writeText(char* text);
-    void writeString(String text);
+    // Text is streamed as it is, without copies: up to a NUL, or `length` characters.
+    void writeText(const char *text);
+    void writeText(const char *text, uint16_t length);
+    void writeText(const __FlashStringHelper *text);
+    void writeString(const String &text);
     // Writes either a byte or a short based on device type
     void writeSpatial(uint16_t value);
     void writeSpatial(uint8_t numValues, uint16_t value1, ...);
+    // Sends any buffered command bytes. Called automatically before reading a response.
+    void sendFrame();
     
     bool getResponse(uint8_t& result);
     bool getResponseShort(uint16_t& result);
     bool getAck();
 
-    bool init();
+    // Pipelined mode: ACK-only commands (drawing, settings) return as soon as they are
+    // sent, and up to `depth` of them may be awaiting their ACK at once. Failures are
+    // recorded and reported through getPipelineErrors() until cleared; getAck() returns
+    // false if an ACK it collected was missing or a NAK, whichever command it belonged to.
+    // Commands that return data wait for all outstanding ACKs first.
+    // Pipelining needs a full-duplex port, since ACKs come back while later commands are
+    // still going out. On SoftwareSerial the depth stays at 1.
+    void setPipelineDepth(uint8_t depth);
+    uint8_t getPipelineDepth();
+    bool drainPipeline();
+    uint8_t getPendingAcks();
+    uint32_t getAckCount();
+    uint16_t getPipelineErrors();
+    void clearPipelineErrors();
+
+    // Asynchronous mode: ACK-only commands are queued and return immediately.
+    // Call poll() from loop() to transmit queued bytes and process ACKs a little at a time.
+    // Each queued command gets a handle (getLastHandle()) which is passed to the
+    // completion callback; failures also count towards getPipelineErrors().
+    // When the queue is full, new commands wait for room.
+    // Needs a hardware serial port: ACKs come back while poll() is still sending, and
+    // SoftwareSerial can't receive while it sends.
+    void setAsync(bool enabled);
+    bool isAsync();
+    // Never waits on the display, except after a timeout: then it waits for the display
+    // to go quiet and fails every command already sent.
+    void poll();
+    bool isQueueEmpty();
+    uint8_t getQueuedCommands();
+    uint16_t getLastHandle();
+    bool isComplete(uint16_t handle);
+    void setCompletionCallback(OLEDCommandCallback callback);
+
+#if OLED_TELEMETRY
+    // Per-opcode bytes, ACK/NAK/timeout counts and latency histograms.
+    OLEDTelemetry &getTelemetry();
+#endif
+
+    // With negotiateBaud, steps up through the supported rates (no higher than maxBaudRate),
+    // checking each with device info and SD sector round trips, and settles on the fastest
+    // one that holds up. A burst of timeouts or garbled responses later on steps the rate
+    // back down before the next command (NAKs don't count: they arrived intact).
+    bool init(bool negotiateBaud = false, uint32_t maxBaudRate = OLED_BAUD_NEGOTIATE_MAX_DEFAULT);
     void reset();
+    // True once after a step down had to reset the display to reach it: the screen was
+    // cleared and user bitmaps are gone. Fill, font and background are put back.
+    bool wasLinkReset();
 
     // General
+    // False, without telling the display, for rates the serial port can't be set to.
     bool setBaud(uint32_t baudRate);
+    uint32_t getBaud();
+    // The OLED_PRM_BAUD_* byte for a baud rate; false if the display doesn't support it.
+    static bool getBaudByte(uint32_t baudRate, uint8_t &baudByte);
+    // Forgets the observed command latencies and goes back to the built-in estimates.
+    void resetResponseTimeouts();
+    // Font, opacity, fill and background commands are skipped when the display already has
+    // that setting. Call this if something else (a script, a command run from SD) may have
+    // changed them behind the library's back.
+    void invalidateState();
     bool getDeviceInfo(bool displayOnScreen);
     DeviceType getDeviceType();
     ControllerType getControllerType();
@@ -256,6 +348,38 @@ public:
     bool readPixel(uint16_t x, uint16_t y, Color& resultColor);
     bool drawPixel(uint16_t x, uint16_t y, uint16_t color);
     bool drawPixel(uint16_t x, uint16_t y, Color color);
+    // Pixel batching: between beginPixels() and endPixels(), drawPixel only collects pixels.
+    // They're sent a batch at a time: as lines and filled rectangles along runs of one color,
+    // or as a single image block where that works out smaller. A pixel drawn twice in a batch
+    // keeps its last color. Other commands don't wait for the batch; flushPixels() first
+    // if they have to go on top of it.
+    bool beginPixels();
+    bool flushPixels();
+    bool endPixels();
+    // Clipping: lines, rectangles, triangles, polygons and circles are cut to the screen, and
+    // to the clip rectangle if there is one, before they're sent. Anything entirely outside
+    // isn't sent at all, and counts as drawn. Text and images aren't clipped.
+    // Shapes may start off the top or left edge: their coordinates are read as int16_t, so
+    // drawLine(-10, 5, 20, 5, color) passes -10 as 65526 and it comes back out as -10.
+    // Everything else (text, images, copies, clip and frame rectangles) is unsigned.
+    void setClipRect(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+    void clearClipRect();
+    // Double buffering: between beginFrame() and endFrame(), drawing meant for the front
+    // rectangle goes to a back buffer of the same size somewhere the viewer doesn't look
+    // (behind a bezel, or a band of a bigger panel the sketch leaves alone). endFrame()
+    // shows the frame with one screenCopyPaste of the area that was drawn to.
+    // Coordinates stay those of the front rectangle, and shapes are clipped to it. Text
+    // placed by character cells moves by whole cells, so keep the back buffer a whole
+    // number of cells away. The back buffer keeps its pixels from frame to frame: draw
+    // the whole rectangle in the first frame, then just what changes.
+    // In a frame, clear() fills just the back buffer with the background and
+    // screenCopyPaste() copies within it. replaceBackground() can only work on the whole
+    // screen, so it fails until endFrame().
+    bool setBackBuffer(uint16_t frontX, uint16_t frontY, uint16_t width, uint16_t height,
+        uint16_t backX, uint16_t backY);
+    void clearBackBuffer();
+    bool beginFrame();
+    bool endFrame();
     bool drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
     bool drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
     bool drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
@@ -270,15 +394,24 @@ public:
         uint16_t color);
     bool drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
         Color color);
+    // Polygon outlines, with any number of vertices
     bool drawPolygon(uint16_t color, uint8_t numVertices, uint16_t x1, uint16_t y1, ...);
     bool drawPolygon(Color color, uint8_t numVertices, uint16_t x1, uint16_t y1, ...);
     bool drawPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2]);
     bool drawPolygon(Color color, uint8_t numVertices, uint16_t vertices[][2]);
+    // Always filled, as triangles. The edges mustn't cross each other.
+    bool fillPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2]);
+    bool fillPolygon(Color color, uint8_t numVertices, uint16_t vertices[][2]);
     bool drawCircle(uint16_t x, uint16_t y, uint16_t radius, uint16_t color);
     bool drawCircle(uint16_t x, uint16_t y, uint16_t radius, Color color);
     bool addUserBitmap(uint8_t char_index,
         uint8_t data1, uint8_t data2, uint8_t data3, uint8_t data4,
         uint8_t data5, uint8_t data6, uint8_t data7, uint8_t data8);
+    bool addUserBitmap(uint8_t charIndex, const uint8_t *data);
+    bool addUserBitmap_P(uint8_t charIndex, const uint8_t *data);
+    // Whether the slot has been loaded since the display was last reset. An upload whose
+    // ACK fails late (pipelined or async) clears it again, so it gets uploaded again.
+    bool hasUserBitmap(uint8_t charIndex);
     bool drawUserBitmap(uint8_t charIndex, uint16_t x, uint16_t y, uint16_t color);
     bool drawUserBitmap(uint8_t charIndex, uint16_t x, uint16_t y, Color color);
     bool setFill(bool fillShapes);
@@ -288,50 +421,141 @@ public:
     bool setBackground(Color color);
     bool replaceBackground(uint16_t color);
     bool replaceBackground(Color color);
-    // TODO
+    // Images are rows of pixels, top to bottom: RRRGGGBB bytes or RGB565 shorts.
+    // The pixels are streamed from where they are, in strips of up to OLED_IMAGE_STRIP_BYTES.
+    // The _P versions read them from PROGMEM.
     bool drawImage8Bit(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
-        uint8_t pixel1, ...);
+        const uint8_t *pixels);
     bool drawImage16Bit(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
-        uint16_t pixel1, ...);
+        const uint16_t *pixels);
+    bool drawImage8Bit_P(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
+        const uint8_t *pixels);
+    bool drawImage16Bit_P(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
+        const uint16_t *pixels);
+
+    // Shadow framebuffer: drawing is mirrored into it so readPixel can be answered without
+    // a round trip. The caller keeps ownership; 0 detaches it. See OLEDShadow.h.
+    // Pipelined and asynchronous commands are mirrored before their ACKs arrive; if one
+    // then fails, everything drawn since the pipeline was last empty is marked unknown.
+    void setShadow(OLEDShadow *shadow);
+    OLEDShadow *getShadow();
+    // Every nth readPixel answered from the shadow also reads the display and compares.
+    // 0 never checks.
+    void setShadowVerifyInterval(uint16_t interval);
+    // Reads back up to `samples` random shadowed pixels; false if any of them differed.
+    bool verifyShadow(uint16_t samples);
+    uint16_t getShadowMismatches();
+    void clearShadowMismatches();
 
     // Text
     bool setFont(uint8_t fontSize);
     bool setFontOpacity(bool opaque);
     void setButtonOpacity(bool opaque);
     void setFontProportional(bool proportional);
+    // Character cell size of a non-proportional font; defaults to the current font.
+    uint8_t getFontWidth(uint8_t fontSize = OLED_FONT_SIZE_NOT_SET);
+    uint8_t getFontHeight(uint8_t fontSize = OLED_FONT_SIZE_NOT_SET);
     void setFontColor(uint16_t color);
     void setFontColor(Color color);
     void setButtonColor(uint16_t color);
     void setButtonColor(Color color);
     void setButtonFontColor(uint16_t color);
     void setButtonFontColor(Color color);
-    bool drawText(uint8_t col, uint8_t row, String text, uint16_t color,
+    // Text comes as a String, a C string, an F() string or a pointer and a length (the N
+    // versions); only String needs the heap.
+    bool drawText(uint8_t col, uint8_t row, const String &text, uint16_t color,
         uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
         uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
-    bool drawText(uint8_t col, uint8_t row, String text, Color color,
+    bool drawText(uint8_t col, uint8_t row, const String &text, Color color,
         uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
         uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
-    bool drawText(uint8_t col, uint8_t row, String text);
-    bool drawTextGraphic(uint16_t x, uint16_t y, String text,
+    bool drawText(uint8_t col, uint8_t row, const String &text);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const String &text,
         uint8_t width, uint8_t height, uint16_t color,
         uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
         uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
-    bool drawTextGraphic(uint16_t x, uint16_t y, String text,
+    bool drawTextGraphic(uint16_t x, uint16_t y, const String &text,
         uint8_t width, uint8_t height, Color color,
         uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
         uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
-    bool drawTextGraphic(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height);
-    bool drawTextGraphic(uint16_t x, uint16_t y, String text);
-    bool drawTextButton(uint16_t x, uint16_t y, String text,
+    bool drawTextGraphic(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const String &text);
+    bool drawTextButton(uint16_t x, uint16_t y, const String &text,
         uint8_t width, uint8_t height, bool pressed, uint16_t fontColor, uint16_t buttonColor,
         uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
         uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
-    bool drawTextButton(uint16_t x, uint16_t y, String text,
+    bool drawTextButton(uint16_t x, uint16_t y, const String &text,
         uint8_t width, uint8_t height, bool pressed, Color fontColor, Color buttonColor,
         uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
         uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
-    bool drawTextButton(uint16_t x, uint16_t y, String text, uint8_t width, uint8_t height,
+    bool drawTextButton(uint16_t x, uint16_t y, const String &text, uint8_t width, uint8_t height,
         bool pressed);
+    bool drawText(uint8_t col, uint8_t row, const char *text, uint16_t color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawText(uint8_t col, uint8_t row, const char *text, Color color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawText(uint8_t col, uint8_t row, const char *text);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const char *text,
+        uint8_t width, uint8_t height, uint16_t color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const char *text,
+        uint8_t width, uint8_t height, Color color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const char *text);
+    bool drawTextButton(uint16_t x, uint16_t y, const char *text,
+        uint8_t width, uint8_t height, bool pressed, uint16_t fontColor, uint16_t buttonColor,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextButton(uint16_t x, uint16_t y, const char *text,
+        uint8_t width, uint8_t height, bool pressed, Color fontColor, Color buttonColor,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextButton(uint16_t x, uint16_t y, const char *text, uint8_t width, uint8_t height,
+        bool pressed);
+    bool drawText(uint8_t col, uint8_t row, const __FlashStringHelper *text, uint16_t color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawText(uint8_t col, uint8_t row, const __FlashStringHelper *text, Color color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawText(uint8_t col, uint8_t row, const __FlashStringHelper *text);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text,
+        uint8_t width, uint8_t height, uint16_t color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text,
+        uint8_t width, uint8_t height, Color color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text,
+        uint8_t width, uint8_t height);
+    bool drawTextGraphic(uint16_t x, uint16_t y, const __FlashStringHelper *text);
+    bool drawTextButton(uint16_t x, uint16_t y, const __FlashStringHelper *text,
+        uint8_t width, uint8_t height, bool pressed, uint16_t fontColor, uint16_t buttonColor,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextButton(uint16_t x, uint16_t y, const __FlashStringHelper *text,
+        uint8_t width, uint8_t height, bool pressed, Color fontColor, Color buttonColor,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextButton(uint16_t x, uint16_t y, const __FlashStringHelper *text,
+        uint8_t width, uint8_t height, bool pressed);
+    bool drawTextN(uint8_t col, uint8_t row, const char *text, uint16_t length, uint16_t color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextGraphicN(uint16_t x, uint16_t y, const char *text, uint16_t length,
+        uint8_t width, uint8_t height, uint16_t color,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
+    bool drawTextButtonN(uint16_t x, uint16_t y, const char *text, uint16_t length,
+        uint8_t width, uint8_t height, bool pressed, uint16_t fontColor, uint16_t buttonColor,
+        uint8_t fontSize = OLED_FONT_SIZE_NOT_SET, uint8_t opacity = OLED_FONT_OPACITY_NOT_SET,
+        uint8_t proportional = OLED_FONT_PROPORTIONAL_NOT_SET);
 
     // SD Card
     bool SDInitialize();
@@ -350,8 +574,9 @@ public:
     bool SDWriteLong(uint32_t data);
     bool SDWriteLong(uint16_t numValues, uint32_t *values);
     bool SDWriteLong(uint16_t numValues, uint32_t value1, ...);
-    bool SDWriteText(char* text);
-    bool SDWriteString(String data);
+    bool SDWriteText(const char *text);
+    bool SDWriteText(const __FlashStringHelper *text);
+    bool SDWriteString(const String &data);
 
     bool SDReadSector(uint32_t sectorAddress, uint8_t *data);
     bool SDReadSector(uint32_t sectorAddress, uint8_t *data, uint16_t &bytesRead);
@@ -363,6 +588,14 @@ public:
     // uint32_t SDWipeCard(uint8_t wipeData);
     
     bool SDWriteScreen(uint32_t sectorAddress);
+    // Uploads a 16 bit image for SDDrawImage, streaming it a sector at a time (no sector
+    // buffer needed). The last sector is padded with zeroes. _P reads it from PROGMEM.
+    bool SDWriteImage(uint32_t sectorAddress, uint16_t width, uint16_t height,
+        const uint16_t *pixels);
+    bool SDWriteImage_P(uint32_t sectorAddress, uint16_t width, uint16_t height,
+        const uint16_t *pixels);
+    // Sectors a 16 bit image of this size takes up
+    static uint32_t SDGetImageSectors(uint16_t width, uint16_t height);
     bool SDWriteScreen(uint32_t sectorAddress,
         uint16_t x, uint16_t y, uint16_t width, uint16_t height);
     bool SDDrawScreen(uint32_t sectorAddress);
@@ -374,22 +607,145 @@ public:
     bool SDRunScript(uint32_t address);
 
 private:
+    void _initFields(uint8_t pinReset, uint32_t baudRate, uint16_t initDelay);
+
+    enum TimingClass { TimingQuick, TimingDraw, TimingText, TimingScreen,
+        TimingSDSector, TimingSDScreen, TimingSlow, TimingClassCount };
+
+    bool _readResponse(uint8_t& result);
+    bool _waitForByte(uint8_t& result, uint32_t timeoutUs);
+    TimingClass _getTimingClass(uint8_t opcode, uint8_t subcode);
+    uint32_t _getDefaultExecutionUs(TimingClass timingClass);
+    uint32_t _getByteTimeUs();
+    uint32_t _getCommandTimeout();
+    uint32_t _getScreenPixels();
+    uint32_t _getShapePixels(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+    void _learnLatency(uint32_t elapsedUs);
+    bool _waitForAck();
+    bool _collectAck();
+    void _resolveAck(bool success);
+    void _discardInput(uint32_t timeoutUs);
+
+    void _writeFrame();
+    void _queueBytes(const uint8_t *values, uint16_t numValues);
+    void _queueCommand();
+    void _completeCommand(bool success);
+    void _clearQueue();
+
     bool _getDeviceResolution();
 
-    bool _getBaudByte(uint32_t baudRate, uint8_t &baudByte);
+    bool _connect(uint32_t baudRate);
+    void _applyDefaults();
+    bool _negotiateBaud(uint32_t maxBaudRate);
+    bool _verifyBaud(bool checkSD, uint16_t sectorChecksum);
+    bool _readSectorChecksum(uint32_t sectorAddress, uint16_t &checksum);
+    void _noteLinkResult(bool received, uint8_t response);
+    bool _stepDownBaud();
+    void _checkLink();
 
     DeviceType _convertDeviceType(uint8_t deviceTypeResponse);
     uint16_t _convertResolution(uint8_t resolutionResponse);
 
     static bool _checkDrawTextParameters(uint8_t fontSize, uint8_t opacity, uint8_t proportional);
+    static uint16_t _getTextLength(const char *text, uint16_t length, bool progmem);
+    void _writeText(const char *text, uint16_t length, bool progmem);
+    bool _drawText(uint8_t col, uint8_t row, const char *text, uint16_t length, bool progmem,
+        uint16_t color, uint8_t fontSize, uint8_t opacity, uint8_t proportional);
+    bool _drawTextGraphic(uint16_t x, uint16_t y, const char *text, uint16_t length, bool progmem,
+        uint8_t width, uint8_t height, uint16_t color,
+        uint8_t fontSize, uint8_t opacity, uint8_t proportional);
+    bool _drawTextButton(uint16_t x, uint16_t y, const char *text, uint16_t length, bool progmem,
+        uint8_t width, uint8_t height, bool pressed, uint16_t fontColor, uint16_t buttonColor,
+        uint8_t fontSize, uint8_t opacity, uint8_t proportional);
+    bool _SDWriteText(const char *text, uint16_t length, bool progmem);
+    bool _drawWipeProgress(uint16_t &filled, uint32_t sector, uint32_t done, uint32_t total,
+        bool label);
 
     bool _drawPolygonVa(uint16_t color, uint8_t numVertices, uint16_t x1, uint16_t y1, va_list ap);
+    enum ClipEdges { ClipLeft = 0x01, ClipRight = 0x02, ClipTop = 0x04, ClipBottom = 0x08 };
+    bool _getClip(int32_t &x1, int32_t &y1, int32_t &x2, int32_t &y2);
+    bool _clipLine(int32_t &x1, int32_t &y1, int32_t &x2, int32_t &y2);
+    bool _drawClippedPixel(int32_t x, int32_t y, uint16_t color);
+    bool _drawClippedTriangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3,
+        uint16_t color);
+    bool _drawClippedCircle(int32_t x, int32_t y, int32_t radius, uint16_t color);
+    void _toBackBuffer(uint16_t &x, uint16_t &y);
+    void _markFrameDirty(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+    bool _sendLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+    bool _sendRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+    bool _sendTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
+        uint16_t color);
+    bool _sendPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2]);
+    bool _drawPolyline(uint16_t color, uint8_t numVertices, uint16_t vertices[][2]);
+    bool _fillPolygon(uint16_t color, uint8_t numVertices, uint16_t vertices[][2]);
+    bool _sendCircle(uint16_t x, uint16_t y, uint16_t radius, uint16_t color);
+    int16_t _findBatchPixel(uint16_t x, uint16_t y);
+    bool _isBatchRun(int16_t first, uint16_t x2, uint16_t y, uint16_t color);
+    bool _sendPixelRuns(bool send, uint32_t &cost);
+    bool _sendPixelImage(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+    bool _drawImage(uint16_t x, uint16_t y, uint16_t imageWidth, uint16_t imageHeight,
+        const uint8_t *pixels, uint8_t bytesPerPixel, bool progmem);
+    void _writeImageHeader(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+        uint8_t bytesPerPixel);
+    bool _SDWriteImage(uint32_t sectorAddress, uint16_t width, uint16_t height,
+        const uint16_t *pixels, bool progmem);
+    bool _readDevicePixel(uint16_t x, uint16_t y, uint16_t &color);
+    bool _checkShadowPixel(uint16_t x, uint16_t y, uint16_t expected, uint16_t &actual);
+    void _markShadowUnknown(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+    void _markShadowUnconfirmed(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+    void _resolveShadow(bool success);
 
     uint8_t _pinReset;
     uint16_t _initDelay;
     uint32_t _baudRate;
+    bool _baudNegotiated;
+    bool _baudNegotiating;
+    uint8_t _linkFailures;
+    bool _linkReset;
     
     SerialContainer *_serial;
+    bool _ownsSerial;
+
+    uint8_t _frame[OLED_FRAME_BUFFER_SIZE];
+    uint8_t _frameLength;
+
+    uint32_t _serialBaud;
+    uint8_t _commandOpcode;
+    uint8_t _commandSubcode;
+    uint16_t _commandLength;
+    uint32_t _commandTxUs;
+    uint32_t _commandPixels;    // Pixels the command being sent touches
+    uint32_t _executionUs[TimingClassCount];
+
+    uint8_t _pipelineDepth;
+    uint8_t _pendingAcks;
+    uint32_t _ackCount;
+    uint16_t _pipelineErrors;
+    uint32_t _pendingTimeoutUs;
+
+    struct QueuedCommand
+    {
+        uint32_t end; // Value of _asyncBytesQueued after the command's last byte
+        uint16_t handle;
+        uint32_t timeoutUs;
+    };
+    bool _async;
+    uint8_t *_asyncBytes;
+    uint16_t _asyncByteHead;
+    uint16_t _asyncByteCount;
+    uint32_t _asyncBytesQueued;
+    uint32_t _asyncBytesSent;
+    QueuedCommand *_asyncCommands;
+    uint8_t _asyncCommandHead;
+    uint8_t _asyncCommandCount;
+    uint16_t _asyncNextHandle;
+    bool _asyncWaiting;
+    uint32_t _asyncWaitStart;
+    OLEDCommandCallback _asyncCallback;
+
+#if OLED_TELEMETRY
+    OLEDTelemetry _telemetry;
+#endif
 
     ControllerType _controllerType;
     DeviceType _deviceType;
@@ -405,8 +761,57 @@ private:
     bool _fontOpacity;
     bool _buttonOpacity;
     bool _fontProportional;
+    // What the display was last told, for mirroring into the shadow and skipping repeats
+    bool _fillShapes;
+    uint16_t _background;
+    bool _deviceFontOpacity;
+    enum StateFlags { StateFont = 0x01, StateFontOpacity = 0x02, StateFill = 0x04,
+        StateBackground = 0x08 };
+    uint8_t _stateKnown;
+    bool _applyFontOpacity(bool opaque);
+
+    // Clip rectangle; the whole coordinate range when there isn't one
+    uint16_t _clipX1;
+    uint16_t _clipY1;
+    uint16_t _clipX2;
+    uint16_t _clipY2;
+
+    // Double buffering; drawing is moved by the origin only while in a frame
+    bool _hasBackBuffer;
+    bool _inFrame;
+    uint16_t _frontX;
+    uint16_t _frontY;
+    uint16_t _frameWidth;
+    uint16_t _frameHeight;
+    uint16_t _backX;
+    uint16_t _backY;
+    int16_t _originX;
+    int16_t _originY;
+    int32_t _dirtyX1;
+    int32_t _dirtyY1;
+    int32_t _dirtyX2;
+    int32_t _dirtyY2;
+
+    OLEDShadow *_shadow;
+    uint16_t _shadowVerifyInterval;
+    uint16_t _shadowReads;
+    uint16_t _shadowMismatches;
+    int32_t _unconfirmedX1;     // Mirrored while ACKs were outstanding; empty if X1 > X2
+    int32_t _unconfirmedY1;
+    int32_t _unconfirmedX2;
+    int32_t _unconfirmedY2;
+
+    struct BatchPixel
+    {
+        uint16_t x, y, color;
+        bool sent;
+    };
+    BatchPixel *_pixelBatch;
+    uint8_t _pixelBatchCount;
+    bool _batchingPixels;
 
     bool _charIndexList[32];
+    uint32_t _unconfirmedBitmaps; // Slots uploaded while ACKs were outstanding
 };
 
 #endif
@@ -0,0 +1,124 @@
+#ifndef OLEDCommands_h
+#define OLEDCommands_h
+
+#include <inttypes.h>
+
+#include "FourDuino.h"
+
+//
+// Command encoding
+//
+// The bytes of each drawing command, up to (not including) its response. OLED and
+// BasicOLED both send their commands through here, so the wire format is written once.
+// Out is whichever of them is sending: anything with write(uint8_t), writeShort(uint16_t)
+// and writeSpatial(uint16_t).
+//
+class OLEDCommands
+{
+public:
+    template <class Out> static void autoBaud(Out &out)
+    {
+        out.write(OLED_CMD_BAUD_AUTO);
+    }
+
+    // baudByte from OLED::getBaudByte
+    template <class Out> static void baud(Out &out, uint8_t baudByte)
+    {
+        out.write(OLED_CMD_BAUD);
+        out.write(baudByte);
+    }
+
+    template <class Out> static void clear(Out &out)
+    {
+        out.write(OLED_CMD_CLEAR_SCREEN);
+    }
+
+    template <class Out> static void fill(Out &out, bool fillShapes)
+    {
+        out.write(OLED_CMD_SET_SHAPE_FILL);
+        out.write(fillShapes ? OLED_PRM_SHAPE_FILL_SOLID : OLED_PRM_SHAPE_FILL_EMPTY);
+    }
+
+    template <class Out> static void background(Out &out, uint16_t color)
+    {
+        out.write(OLED_CMD_SET_BACKGROUND);
+        out.writeShort(color);
+    }
+
+    template <class Out> static void readPixel(Out &out, uint16_t x, uint16_t y)
+    {
+        out.write(OLED_CMD_READ_PIXEL);
+        point(out, x, y);
+    }
+
+    template <class Out> static void pixel(Out &out, uint16_t x, uint16_t y, uint16_t color)
+    {
+        out.write(OLED_CMD_DRAW_PIXEL);
+        point(out, x, y);
+        out.writeShort(color);
+    }
+
+    template <class Out> static void line(Out &out, uint16_t x1, uint16_t y1, uint16_t x2,
+        uint16_t y2, uint16_t color)
+    {
+        out.write(OLED_CMD_DRAW_LINE);
+        point(out, x1, y1);
+        point(out, x2, y2);
+        out.writeShort(color);
+    }
+
+    template <class Out> static void rectangle(Out &out, uint16_t x1, uint16_t y1, uint16_t x2,
+        uint16_t y2, uint16_t color)
+    {
+        out.write(OLED_CMD_DRAW_RECTANGLE);
+        point(out, x1, y1);
+        point(out, x2, y2);
+        out.writeShort(color);
+    }
+
+    template <class Out> static void triangle(Out &out, uint16_t x1, uint16_t y1, uint16_t x2,
+        uint16_t y2, uint16_t x3, uint16_t y3, uint16_t color)
+    {
+        out.write(OLED_CMD_DRAW_TRIANGLE);
+        point(out, x1, y1);
+        point(out, x2, y2);
+        point(out, x3, y3);
+        out.writeShort(color);
+    }
+
+    // Followed by numVertices point()s and the color
+    template <class Out> static void polygon(Out &out, uint8_t numVertices)
+    {
+        out.write(OLED_CMD_DRAW_POLYGON);
+        out.write(numVertices);
+    }
+
+    template <class Out> static void circle(Out &out, uint16_t x, uint16_t y, uint16_t radius,
+        uint16_t color)
+    {
+        out.write(OLED_CMD_DRAW_CIRCLE);
+        point(out, x, y);
+        out.writeSpatial(radius);
+        out.writeShort(color);
+    }
+
+    template <class Out> static void copyPaste(Out &out, uint16_t sourceX, uint16_t sourceY,
+        uint16_t destX, uint16_t destY, uint16_t sourceWidth, uint16_t sourceHeight)
+    {
+        out.write(OLED_CMD_SCREEN_COPY_PASTE);
+        point(out, sourceX, sourceY);
+        point(out, destX, destY);
+        point(out, sourceWidth, sourceHeight);
+    }
+
+    template <class Out> static void point(Out &out, uint16_t x, uint16_t y)
+    {
+        out.writeSpatial(x);
+        out.writeSpatial(y);
+    }
+
+private:
+    OLEDCommands();
+};
+
+#endif
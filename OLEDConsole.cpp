@@ -0,0 +1,166 @@
+#include "OLEDConsole.h"
+
+OLEDConsole::OLEDConsole(OLED &oled, uint8_t col, uint8_t row, uint8_t columns, uint8_t rows,
+    uint8_t fontSize)
+    : _oled(oled), _col(col), _row(row), _columns(columns), _rows(rows), _fontSize(fontSize),
+    _color(0xFFFF), _first(0), _count(0), _stale(false)
+{
+    _lines = new char[(uint16_t)rows * columns];
+    _colors = new uint16_t[rows];
+    _pending = new char[columns];
+    for (uint16_t c = 0; c < (uint16_t)rows * columns && _lines; c++)
+        _lines[c] = ' ';
+}
+
+OLEDConsole::~OLEDConsole()
+{
+    delete[] _lines;
+    delete[] _colors;
+    delete[] _pending;
+}
+
+void OLEDConsole::setColor(uint16_t color)
+{
+    _color = color;
+}
+
+void OLEDConsole::setColor(Color color)
+{
+    _color = color.to16BitRGB();
+}
+
+uint8_t OLEDConsole::getLineCount() { return _count; }
+
+bool OLEDConsole::println(const char *text)
+{
+    return _println(text, 0xFFFF, false);
+}
+
+bool OLEDConsole::println(const char *text, uint16_t length)
+{
+    return _println(text, length, false);
+}
+
+bool OLEDConsole::println(const __FlashStringHelper *text)
+{
+    return _println((const char *)text, 0xFFFF, true);
+}
+
+bool OLEDConsole::println(const String &text)
+{
+    return _println(text.c_str(), text.length(), false);
+}
+
+bool OLEDConsole::clear()
+{
+    if (!_lines || !_colors)
+        return false;
+    for (uint16_t c = 0; c < (uint16_t)_rows * _columns; c++)
+        _lines[c] = ' ';
+    _first = 0;
+    _count = 0;
+    return redraw();
+}
+
+bool OLEDConsole::redraw()
+{
+    if (!_lines || !_colors)
+        return false;
+    bool result = true;
+    for (uint8_t r = 0; r < _rows; r++)
+        result = _drawRow(r) && result;
+    _stale = !result;
+    return result;
+}
+
+// Unused rows are all spaces, so blank rows draw like any other.
+bool OLEDConsole::_drawRow(uint8_t row)
+{
+    uint8_t slot = (_first + row) % _rows;
+    return _oled.drawTextN(_col, _row + row, _lines + (uint16_t)slot * _columns, _columns,
+        row < _count ? _colors[slot] : _color, _fontSize,
+        OLED_FONT_OPAQUE, OLED_FONT_NONPROPORTIONAL);
+}
+
+bool OLEDConsole::_println(const char *text, uint16_t length, bool progmem)
+{
+    if (!_lines || !_colors || !_pending || _columns == 0 || _rows == 0)
+        return false;
+
+    bool result = true;
+    uint8_t used = 0;
+    for (uint16_t c = 0; c < length; c++)
+    {
+        char character = progmem ? pgm_read_byte(text + c) : text[c];
+        if (character == 0x00)
+            break;
+        if (character == '\r')
+            continue;
+        if (character == '\n')
+        {
+            result = _addLine(used) && result;
+            used = 0;
+            continue;
+        }
+        if (used == _columns)
+        {
+            // Wrap at the last space (which is dropped), or else mid-word.
+            uint8_t space = used;
+            while (space > 0 && _pending[space - 1] != ' ')
+                space--;
+            if (character == ' ' || space == 0)
+            {
+                result = _addLine(used) && result;
+                used = 0;
+                if (character == ' ')
+                    continue;
+            }
+            else
+            {
+                result = _addLine(space - 1) && result;
+                used -= space;
+                memmove(_pending, _pending + space, used);
+            }
+        }
+        _pending[used++] = character;
+    }
+    return _addLine(used) && result;
+}
+
+// Puts _pending in the ring and on the screen: at the bottom, after scrolling everything
+// else up, once the console is full.
+bool OLEDConsole::_addLine(uint8_t length)
+{
+    uint8_t row;
+    bool scroll = _count == _rows;
+    if (scroll)
+    {
+        _first = (_first + 1) % _rows;
+        row = _rows - 1;
+    }
+    else
+        row = _count++;
+    uint8_t slot = (_first + row) % _rows;
+    char *line = _lines + (uint16_t)slot * _columns;
+    for (uint8_t c = 0; c < _columns; c++)
+        line[c] = c < length ? _pending[c] : ' ';
+    _colors[slot] = _color;
+
+    if (_stale)
+        return redraw();
+
+    bool result = true;
+    if (scroll && _rows > 1)
+    {
+        uint8_t fontWidth = _oled.getFontWidth(_fontSize);
+        uint8_t fontHeight = _oled.getFontHeight(_fontSize);
+        uint16_t x = (uint16_t)_col * fontWidth;
+        uint16_t y = (uint16_t)_row * fontHeight;
+        result = _oled.screenCopyPaste(x, y + fontHeight, x, y,
+            (uint16_t)_columns * fontWidth, (uint16_t)(_rows - 1) * fontHeight);
+    }
+    result = result && _drawRow(row);
+    // Whatever the screen shows now, the next line puts all of it right.
+    _stale = !result;
+    return result;
+}
@@ -0,0 +1,71 @@
+#ifndef OLEDConsole_h
+#define OLEDConsole_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+
+//
+// Scrolling console
+//
+// A log in a block of character cells: new lines go in at the bottom and the rest move
+// up. Moving them is one screenCopyPaste; the new line is then drawn opaque and padded
+// with spaces to the console's width, which clears what was left on that row. So a
+// line costs two commands however tall the console is. Until the console fills up,
+// lines are just drawn below the last one.
+//
+// Lines longer than the console are wrapped at the last space, or mid-word if there
+// isn't one, and '\n' starts a new line. The lines on screen are kept in a ring, so
+// redraw() can put them back, e.g. after the screen was cleared.
+//
+//   OLEDConsole log(oled, 0, 2, 21, 14);
+//   log.println(F("Starting up"));
+//   log.setColor(COLOR_RED);
+//   log.println("Sensor " + String(id) + " not found");
+//
+// Text is drawn on the display's background color (setBackground).
+//
+class OLEDConsole
+{
+public:
+    // Position and size in character cells of fontSize
+    OLEDConsole(OLED &oled, uint8_t col, uint8_t row, uint8_t columns, uint8_t rows,
+        uint8_t fontSize = OLED_FONT_SMALL);
+    ~OLEDConsole();
+
+    // For the lines that follow
+    void setColor(uint16_t color);
+    void setColor(Color color);
+
+    bool println(const char *text);
+    bool println(const char *text, uint16_t length);
+    bool println(const __FlashStringHelper *text);
+    bool println(const String &text);
+    // Empties the console, blanking its area.
+    bool clear();
+    // Draws every row again.
+    bool redraw();
+
+    uint8_t getLineCount();
+
+private:
+    bool _println(const char *text, uint16_t length, bool progmem);
+    bool _addLine(uint8_t length);
+    bool _drawRow(uint8_t row);
+
+    OLED &_oled;
+    uint8_t _col;
+    uint8_t _row;
+    uint8_t _columns;
+    uint8_t _rows;
+    uint8_t _fontSize;
+    uint16_t _color;
+    char *_lines;           // _rows lines of _columns characters, padded with spaces
+    uint16_t *_colors;
+    char *_pending;         // The line being wrapped
+    uint8_t _first;         // Ring index of the top row
+    uint8_t _count;
+    bool _stale;            // The screen may not match the ring; redraw before scrolling
+};
+
+#endif
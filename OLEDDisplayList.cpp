@@ -0,0 +1,291 @@
+#include "OLEDDisplayList.h"
+
+OLEDDisplayList::OLEDDisplayList(OLED &oled, uint16_t background, uint8_t capacity)
+    : _oled(oled), _background(background), _capacity(capacity),
+    _committedCount(0), _pendingCount(0), _invalid(false), _dirtyCount(0),
+    _fill(0xFF), _commandCount(0)
+{
+    _committed = new Primitive[capacity];
+    _pending = new Primitive[capacity];
+}
+
+OLEDDisplayList::~OLEDDisplayList()
+{
+    delete[] _committed;
+    delete[] _pending;
+}
+
+void OLEDDisplayList::setBackground(uint16_t color) { _background = color; }
+void OLEDDisplayList::setBackground(Color color) { _background = color.to16BitRGB(); }
+uint8_t OLEDDisplayList::getCount() { return _pendingCount; }
+uint16_t OLEDDisplayList::getLastCommandCount() { return _commandCount; }
+void OLEDDisplayList::discard() { _pendingCount = 0; }
+void OLEDDisplayList::invalidate() { _invalid = true; }
+
+
+//
+// Declaring primitives
+//
+
+OLEDDisplayList::Primitive *OLEDDisplayList::_add(uint8_t id, uint8_t type,
+    uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, bool filled)
+{
+    if (_pendingCount >= _capacity || _find(_pending, _pendingCount, id))
+        return 0;
+    Primitive &primitive = _pending[_pendingCount++];
+    primitive.id = id;
+    primitive.type = type;
+    primitive.filled = filled;
+    primitive.changed = false;
+    primitive.x1 = x1;
+    primitive.y1 = y1;
+    primitive.x2 = x2;
+    primitive.y2 = y2;
+    primitive.color = color;
+    primitive.text[0] = '\0';
+    return &primitive;
+}
+
+bool OLEDDisplayList::drawLine(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+    uint16_t color)
+{
+    return _add(id, Line, x1, y1, x2, y2, color, false) != 0;
+}
+
+bool OLEDDisplayList::drawLine(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+    Color color)
+{
+    return drawLine(id, x1, y1, x2, y2, color.to16BitRGB());
+}
+
+bool OLEDDisplayList::drawRectangle(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+    uint16_t color, bool filled)
+{
+    return _add(id, Rectangle, min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2),
+        color, filled) != 0;
+}
+
+bool OLEDDisplayList::drawRectangle(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+    Color color, bool filled)
+{
+    return drawRectangle(id, x1, y1, x2, y2, color.to16BitRGB(), filled);
+}
+
+bool OLEDDisplayList::drawCircle(uint8_t id, uint16_t x, uint16_t y, uint16_t radius,
+    uint16_t color, bool filled)
+{
+    return _add(id, Circle, x, y, radius, 0, color, filled) != 0;
+}
+
+bool OLEDDisplayList::drawCircle(uint8_t id, uint16_t x, uint16_t y, uint16_t radius,
+    Color color, bool filled)
+{
+    return drawCircle(id, x, y, radius, color.to16BitRGB(), filled);
+}
+
+bool OLEDDisplayList::drawText(uint8_t id, uint16_t x, uint16_t y, String text, uint16_t color,
+    uint8_t fontSize)
+{
+    Primitive *primitive = _add(id, Text, x, y, fontSize, 0, color, false);
+    if (!primitive)
+        return false;
+    text.toCharArray(primitive->text, sizeof(primitive->text));
+    return true;
+}
+
+bool OLEDDisplayList::drawText(uint8_t id, uint16_t x, uint16_t y, String text, Color color,
+    uint8_t fontSize)
+{
+    return drawText(id, x, y, text, color.to16BitRGB(), fontSize);
+}
+
+
+//
+// Diffing
+//
+
+bool OLEDDisplayList::commit()
+{
+    _commandCount = 0;
+    _dirtyCount = 0;
+    _fill = 0xFF;
+
+    // Work out what has to be erased: anything dropped, and anything changed unless
+    // its replacement paints over all of it anyway.
+    for (uint8_t c = 0; c < _committedCount; c++)
+    {
+        Primitive *pending = _find(_pending, _pendingCount, _committed[c].id);
+        if (pending && !_invalid && _same(*pending, _committed[c]))
+            continue;
+        if (pending)
+            pending->changed = true;
+        Rect oldBounds = _getBounds(_committed[c]);
+        if (!pending || _invalid || pending->type != Rectangle || !pending->filled ||
+            !_covers(_getBounds(*pending), oldBounds))
+            _addDirty(oldBounds);
+    }
+    for (uint8_t p = 0; p < _pendingCount; p++)
+    {
+        if (_invalid || !_find(_committed, _committedCount, _pending[p].id))
+            _pending[p].changed = true;
+    }
+
+    bool success = true;
+    if (_dirtyCount > 0)
+        success = _setFill(true);
+    for (uint8_t d = 0; d < _dirtyCount && success; d++)
+    {
+        success = _oled.drawRectangle(_dirty[d].x1, _dirty[d].y1, _dirty[d].x2, _dirty[d].y2,
+            _background);
+        _commandCount++;
+    }
+
+    // Draw everything that changed, plus anything overlapping an erased or repainted area.
+    // Whatever gets drawn may cover primitives above it, so it counts as repainted too.
+    for (uint8_t p = 0; p < _pendingCount && success; p++)
+    {
+        Rect bounds = _getBounds(_pending[p]);
+        bool draw = _pending[p].changed;
+        for (uint8_t d = 0; d < _dirtyCount && !draw; d++)
+            draw = _intersects(bounds, _dirty[d]);
+        if (!draw)
+            continue;
+        success = _draw(_pending[p]);
+        _addDirty(bounds);
+    }
+
+    // Whatever happened, this frame is now what the list believes is on screen.
+    // If sending failed, the screen is in an unknown state, so redraw it all next time.
+    Primitive *swap = _committed;
+    _committed = _pending;
+    _pending = swap;
+    _committedCount = _pendingCount;
+    _pendingCount = 0;
+    _invalid = !success;
+    return success;
+}
+
+OLEDDisplayList::Primitive *OLEDDisplayList::_find(Primitive *list, uint8_t count, uint8_t id)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (list[i].id == id)
+            return &list[i];
+    }
+    return 0;
+}
+
+bool OLEDDisplayList::_same(const Primitive &a, const Primitive &b)
+{
+    return a.type == b.type &&
+        a.filled == b.filled &&
+        a.x1 == b.x1 && a.y1 == b.y1 && a.x2 == b.x2 && a.y2 == b.y2 &&
+        a.color == b.color &&
+        strcmp(a.text, b.text) == 0;
+}
+
+OLEDDisplayList::Rect OLEDDisplayList::_getBounds(const Primitive &primitive)
+{
+    Rect bounds;
+    switch (primitive.type)
+    {
+    case Circle:
+        bounds.x1 = primitive.x1 > primitive.x2 ? primitive.x1 - primitive.x2 : 0;
+        bounds.y1 = primitive.y1 > primitive.x2 ? primitive.y1 - primitive.x2 : 0;
+        bounds.x2 = primitive.x1 + primitive.x2;
+        bounds.y2 = primitive.y1 + primitive.x2;
+        break;
+    case Text:
+    {
+        uint16_t length = strlen(primitive.text);
+        bounds.x1 = primitive.x1;
+        bounds.y1 = primitive.y1;
+        bounds.x2 = primitive.x1 + max(length, (uint16_t)1) * _oled.getFontWidth(primitive.x2) - 1;
+        bounds.y2 = primitive.y1 + _oled.getFontHeight(primitive.x2) - 1;
+        break;
+    }
+    case Line:
+    case Rectangle:
+    default:
+        bounds.x1 = min(primitive.x1, primitive.x2);
+        bounds.y1 = min(primitive.y1, primitive.y2);
+        bounds.x2 = max(primitive.x1, primitive.x2);
+        bounds.y2 = max(primitive.y1, primitive.y2);
+        break;
+    }
+    return bounds;
+}
+
+bool OLEDDisplayList::_intersects(const Rect &a, const Rect &b)
+{
+    return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+}
+
+bool OLEDDisplayList::_covers(const Rect &outer, const Rect &inner)
+{
+    return outer.x1 <= inner.x1 && outer.y1 <= inner.y1 &&
+        outer.x2 >= inner.x2 && outer.y2 >= inner.y2;
+}
+
+// Keeps the dirty list short: rects inside one already listed are dropped, and once
+// the list is full the newcomer is merged into the last entry.
+void OLEDDisplayList::_addDirty(Rect rect)
+{
+    for (uint8_t d = 0; d < _dirtyCount; d++)
+    {
+        if (_covers(_dirty[d], rect))
+            return;
+    }
+    if (_dirtyCount < OLED_DISPLAY_LIST_DIRTY_RECTS)
+    {
+        _dirty[_dirtyCount++] = rect;
+        return;
+    }
+    Rect &last = _dirty[_dirtyCount - 1];
+    last.x1 = min(last.x1, rect.x1);
+    last.y1 = min(last.y1, rect.y1);
+    last.x2 = max(last.x2, rect.x2);
+    last.y2 = max(last.y2, rect.y2);
+}
+
+
+//
+// Drawing
+//
+
+bool OLEDDisplayList::_setFill(bool filled)
+{
+    if (_fill == (uint8_t)filled)
+        return true;
+    _commandCount++;
+    if (!_oled.setFill(filled))
+    {
+        _fill = 0xFF;
+        return false;
+    }
+    _fill = filled;
+    return true;
+}
+
+bool OLEDDisplayList::_draw(const Primitive &primitive)
+{
+    _commandCount++;
+    switch (primitive.type)
+    {
+    case Line:
+        return _oled.drawLine(primitive.x1, primitive.y1, primitive.x2, primitive.y2,
+            primitive.color);
+    case Rectangle:
+        return _setFill(primitive.filled) &&
+            _oled.drawRectangle(primitive.x1, primitive.y1, primitive.x2, primitive.y2,
+                primitive.color);
+    case Circle:
+        return _setFill(primitive.filled) &&
+            _oled.drawCircle(primitive.x1, primitive.y1, primitive.x2, primitive.color);
+    case Text:
+        return _oled.drawTextGraphic(primitive.x1, primitive.y1, primitive.text, 1, 1,
+            primitive.color, primitive.x2, OLED_FONT_OPACITY_NOT_SET, OLED_FONT_NONPROPORTIONAL);
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef OLEDDisplayList_h
+#define OLEDDisplayList_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+
+#define OLED_DISPLAY_LIST_CAPACITY      12  // Primitives per list by default
+#define OLED_DISPLAY_LIST_TEXT_LENGTH   12  // Longest text primitive; longer text is cut off
+#define OLED_DISPLAY_LIST_DIRTY_RECTS   6   // Erased areas tracked per commit; more get merged
+
+//
+// Retained-mode display list
+//
+// Instead of redrawing a screen, declare what should be on it every frame, each primitive
+// with an ID of your choosing, then commit(). Only the primitives that were added, moved,
+// changed or dropped since the last commit are sent: the area each one used to cover is
+// erased to the background, and anything declared over an erased area is drawn again.
+// Primitives are drawn in the order they were declared, so later ones sit on top.
+//
+//   OLEDDisplayList screen(oled);
+//   screen.drawRectangle(1, 0, 0, 127, 9, COLOR_NAVY, true);
+//   screen.drawText(2, 2, 1, "Temp: " + String(temperature), COLOR_WHITE);
+//   screen.commit();
+//
+// Text is drawn with drawTextGraphic, non-proportional so its size is known, in whatever
+// font opacity the display is set to.
+// The list doesn't know about anything drawn outside it; invalidate() after drawing over it.
+//
+class OLEDDisplayList
+{
+public:
+    OLEDDisplayList(OLED &oled, uint16_t background = 0x0000,
+        uint8_t capacity = OLED_DISPLAY_LIST_CAPACITY);
+    ~OLEDDisplayList();
+
+    // Color erased areas are filled with. Should match the screen's background.
+    void setBackground(uint16_t color);
+    void setBackground(Color color);
+
+    // Each returns false if the list is full or the ID is already used this frame.
+    bool drawLine(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+    bool drawLine(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
+    bool drawRectangle(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+        uint16_t color, bool filled = false);
+    bool drawRectangle(uint8_t id, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+        Color color, bool filled = false);
+    bool drawCircle(uint8_t id, uint16_t x, uint16_t y, uint16_t radius,
+        uint16_t color, bool filled = false);
+    bool drawCircle(uint8_t id, uint16_t x, uint16_t y, uint16_t radius,
+        Color color, bool filled = false);
+    bool drawText(uint8_t id, uint16_t x, uint16_t y, String text, uint16_t color,
+        uint8_t fontSize = OLED_FONT_SMALL);
+    bool drawText(uint8_t id, uint16_t x, uint16_t y, String text, Color color,
+        uint8_t fontSize = OLED_FONT_SMALL);
+
+    // Sends the difference between this frame and the last one, then starts a new frame.
+    bool commit();
+    // Throws away the frame being declared.
+    void discard();
+    // Next commit() erases everything from the last one and redraws the whole frame.
+    void invalidate();
+
+    uint8_t getCount();
+    // Commands sent by the last commit()
+    uint16_t getLastCommandCount();
+
+private:
+    enum PrimitiveType { Line, Rectangle, Circle, Text };
+
+    struct Primitive
+    {
+        uint8_t id;
+        uint8_t type;
+        bool filled;
+        bool changed;
+        uint16_t x1, y1, x2, y2; // Circle: centre and radius in x2. Text: font size in x2.
+        uint16_t color;
+        char text[OLED_DISPLAY_LIST_TEXT_LENGTH + 1];
+    };
+
+    struct Rect
+    {
+        uint16_t x1, y1, x2, y2;
+    };
+
+    Primitive *_add(uint8_t id, uint8_t type, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+        uint16_t color, bool filled);
+    Primitive *_find(Primitive *list, uint8_t count, uint8_t id);
+    static bool _same(const Primitive &a, const Primitive &b);
+    Rect _getBounds(const Primitive &primitive);
+    static bool _intersects(const Rect &a, const Rect &b);
+    static bool _covers(const Rect &outer, const Rect &inner);
+    void _addDirty(Rect rect);
+    bool _setFill(bool filled);
+    bool _draw(const Primitive &primitive);
+
+    OLED &_oled;
+    uint16_t _background;
+    uint8_t _capacity;
+
+    Primitive *_committed;
+    uint8_t _committedCount;
+    Primitive *_pending;
+    uint8_t _pendingCount;
+    bool _invalid;
+
+    Rect _dirty[OLED_DISPLAY_LIST_DIRTY_RECTS];
+    uint8_t _dirtyCount;
+    // Fill mode this list last set on the display during a commit; 0xFF if unknown
+    uint8_t _fill;
+    uint16_t _commandCount;
+};
+
+#endif
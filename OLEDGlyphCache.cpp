@@ -0,0 +1,90 @@
+#include "OLEDGlyphCache.h"
+
+OLEDGlyphCache::OLEDGlyphCache(OLED &oled, uint8_t firstSlot, uint8_t slotCount)
+    : _oled(oled), _firstSlot(firstSlot)
+{
+    _slotCount = firstSlot < OLED_MAX_USER_BITMAPS
+        ? min(slotCount, (uint8_t)(OLED_MAX_USER_BITMAPS - firstSlot)) : 0;
+    _slots = new Slot[_slotCount];
+    clear();
+}
+
+OLEDGlyphCache::~OLEDGlyphCache()
+{
+    delete[] _slots;
+}
+
+void OLEDGlyphCache::clear()
+{
+    for (uint8_t s = 0; s < _slotCount && _slots; s++)
+        _slots[s].glyph = 0;
+    _clock = 0;
+    _hits = 0;
+    _uploads = 0;
+}
+
+uint32_t OLEDGlyphCache::getHits() { return _hits; }
+uint32_t OLEDGlyphCache::getUploads() { return _uploads; }
+
+bool OLEDGlyphCache::draw(const uint8_t *glyph, uint16_t x, uint16_t y, uint16_t color)
+{
+    return _draw(glyph, x, y, color, false);
+}
+
+bool OLEDGlyphCache::draw(const uint8_t *glyph, uint16_t x, uint16_t y, Color color)
+{
+    return _draw(glyph, x, y, color.to16BitRGB(), false);
+}
+
+bool OLEDGlyphCache::draw_P(const uint8_t *glyph, uint16_t x, uint16_t y, uint16_t color)
+{
+    return _draw(glyph, x, y, color, true);
+}
+
+bool OLEDGlyphCache::draw_P(const uint8_t *glyph, uint16_t x, uint16_t y, Color color)
+{
+    return _draw(glyph, x, y, color.to16BitRGB(), true);
+}
+
+bool OLEDGlyphCache::_draw(const uint8_t *glyph, uint16_t x, uint16_t y, uint16_t color,
+    bool progmem)
+{
+    if (!_slots || _slotCount == 0 || !glyph)
+        return false;
+
+    // Resident, or else the free or least recently used slot
+    Slot *slot = 0;
+    Slot *oldest = 0;
+    for (uint8_t s = 0; s < _slotCount && !slot; s++)
+    {
+        Slot &candidate = _slots[s];
+        // A reset empties the device's slots.
+        if (candidate.glyph && !_oled.hasUserBitmap(_firstSlot + s))
+            candidate.glyph = 0;
+        if (candidate.glyph == glyph && candidate.progmem == progmem)
+            slot = &candidate;
+        else if (!oldest || (oldest->glyph && (!candidate.glyph ||
+            (uint16_t)(_clock - candidate.lastUsed) > (uint16_t)(_clock - oldest->lastUsed))))
+            oldest = &candidate;
+    }
+
+    uint8_t index;
+    if (slot)
+    {
+        _hits++;
+        index = _firstSlot + (slot - _slots);
+    }
+    else
+    {
+        slot = oldest;
+        index = _firstSlot + (slot - _slots);
+        slot->glyph = 0;
+        if (!(progmem ? _oled.addUserBitmap_P(index, glyph) : _oled.addUserBitmap(index, glyph)))
+            return false;
+        slot->glyph = glyph;
+        slot->progmem = progmem;
+        _uploads++;
+    }
+    slot->lastUsed = ++_clock;
+    return _oled.drawUserBitmap(index, x, y, color);
+}
@@ -0,0 +1,59 @@
+#ifndef OLEDGlyphCache_h
+#define OLEDGlyphCache_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+
+//
+// User bitmap slot manager
+//
+// Draws 8x8 glyphs through the display's user bitmap slots without the caller keeping
+// track of which glyph lives where. A glyph is identified by its address, so keep its
+// 8 bytes in a constant array (RAM or PROGMEM) and always pass the same one. The first
+// draw uploads it to a free slot; later draws use the slot directly. When every slot is
+// taken, the least recently drawn glyph gives up its slot.
+//
+//   const uint8_t PROGMEM bell[8] = { ... };
+//   OLEDGlyphCache glyphs(oled);
+//   glyphs.draw_P(bell, x, y, COLOR_YELLOW);
+//
+// Slots are picked up again after the display resets. The cache assumes it owns its
+// slots: give it a range that doesn't include any loaded with addUserBitmap directly.
+//
+class OLEDGlyphCache
+{
+public:
+    OLEDGlyphCache(OLED &oled, uint8_t firstSlot = 0, uint8_t slotCount = OLED_MAX_USER_BITMAPS);
+    ~OLEDGlyphCache();
+
+    bool draw(const uint8_t *glyph, uint16_t x, uint16_t y, uint16_t color);
+    bool draw(const uint8_t *glyph, uint16_t x, uint16_t y, Color color);
+    bool draw_P(const uint8_t *glyph, uint16_t x, uint16_t y, uint16_t color);
+    bool draw_P(const uint8_t *glyph, uint16_t x, uint16_t y, Color color);
+    // Forgets which glyph is where; e.g. after a glyph's bytes were changed.
+    void clear();
+
+    uint32_t getHits();
+    uint32_t getUploads();
+
+private:
+    struct Slot
+    {
+        const uint8_t *glyph;
+        uint16_t lastUsed;
+        bool progmem;
+    };
+
+    bool _draw(const uint8_t *glyph, uint16_t x, uint16_t y, uint16_t color, bool progmem);
+
+    OLED &_oled;
+    uint8_t _firstSlot;
+    uint8_t _slotCount;
+    Slot *_slots;
+    uint16_t _clock;
+    uint32_t _hits;
+    uint32_t _uploads;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "OLEDProgressBar.h"
+
+OLEDProgressBar::OLEDProgressBar(OLED &oled, uint16_t x, uint16_t y, uint16_t width,
+    uint16_t height)
+    : _oled(oled), _x(x), _y(y), _width(width), _height(height), _fill(0), _known(false),
+    _labelDrawn(false), _labelInterval(OLED_PROGRESS_LABEL_INTERVAL_MS), _labelTime(0)
+{
+    setColors(OLED_PROGRESSBAR_COLOR_FORE_DEFAULT, OLED_PROGRESSBAR_COLOR_BACK_DEFAULT);
+}
+
+void OLEDProgressBar::setColors(uint16_t foreColor, uint16_t backColor)
+{
+    _foreColor = foreColor;
+    _backColor = backColor;
+    _known = false;
+}
+
+void OLEDProgressBar::setColors(Color foreColor, Color backColor)
+{
+    setColors(foreColor.to16BitRGB(), backColor.to16BitRGB());
+}
+
+void OLEDProgressBar::setLabelInterval(uint16_t intervalMs)
+{
+    _labelInterval = intervalMs;
+}
+
+void OLEDProgressBar::invalidate()
+{
+    _known = false;
+    _labelDrawn = false;
+}
+
+uint16_t OLEDProgressBar::getFillWidth() { return _fill; }
+
+bool OLEDProgressBar::isLabelDue()
+{
+    uint32_t now = millis();
+    if (_labelDrawn && now - _labelTime < _labelInterval)
+        return false;
+    _labelDrawn = true;
+    _labelTime = now;
+    return true;
+}
+
+bool OLEDProgressBar::setPercent(uint8_t progressPercent)
+{
+    return setProgress(progressPercent, 100);
+}
+
+bool OLEDProgressBar::setProgress(uint32_t done, uint32_t total)
+{
+    if (done >= total)
+        done = total = 1;
+    // Keep width * done inside 32 bits.
+    while (total > 0xFFFF)
+    {
+        done >>= 1;
+        total >>= 1;
+    }
+    uint16_t fill = (uint32_t)_width * done / total;
+
+    bool result = true;
+    if (!_known)
+    {
+        if (fill > 0)
+            result = _oled.drawRectangleWH(_x, _y, fill, _height, _foreColor);
+        if (fill < _width)
+            result = _oled.drawRectangleWH(_x + fill, _y, _width - fill, _height, _backColor)
+                && result;
+    }
+    else if (fill > _fill)
+        result = _oled.drawRectangleWH(_x + _fill, _y, fill - _fill, _height, _foreColor);
+    else if (fill < _fill)
+        result = _oled.drawRectangleWH(_x + fill, _y, _fill - fill, _height, _backColor);
+
+    // A strip that didn't draw is drawn again with the next update.
+    if (result)
+    {
+        _fill = fill;
+        _known = true;
+    }
+    return result;
+}
@@ -0,0 +1,62 @@
+#ifndef OLEDProgressBar_h
+#define OLEDProgressBar_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+
+//
+// Progress bar
+//
+// Remembers how far the bar is filled, so an update only draws the strip between the
+// old and the new fill: nothing at all until progress moves by a whole pixel. The first
+// update (and the first after invalidate()) draws the whole bar.
+//
+// A label that changes with every step would cost more than the bar, so the bar also
+// keeps time for it: isLabelDue() says yes at most once per label interval.
+//
+//   OLEDProgressBar bar(oled, 0, 119, 128, 9);
+//   for (uint32_t i = 0; i < count; i++)
+//   {
+//       bar.setProgress(i, count);
+//       if (bar.isLabelDue())
+//           label.printNumber(i);
+//       ...
+//   }
+//
+class OLEDProgressBar
+{
+public:
+    OLEDProgressBar(OLED &oled, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+    // Take effect with the next update, which redraws the whole bar.
+    void setColors(uint16_t foreColor, uint16_t backColor);
+    void setColors(Color foreColor, Color backColor);
+    void setLabelInterval(uint16_t intervalMs);
+
+    bool setProgress(uint32_t done, uint32_t total);
+    bool setPercent(uint8_t progressPercent);
+    // True if the label hasn't been drawn for at least the label interval. Counts the
+    // label as drawn.
+    bool isLabelDue();
+    // Forgets what the display shows; the next update redraws the whole bar.
+    void invalidate();
+
+    uint16_t getFillWidth();
+
+private:
+    OLED &_oled;
+    uint16_t _x;
+    uint16_t _y;
+    uint16_t _width;
+    uint16_t _height;
+    uint16_t _foreColor;
+    uint16_t _backColor;
+    uint16_t _fill;         // Pixels filled on the display, valid only if _known
+    bool _known;
+    bool _labelDrawn;
+    uint16_t _labelInterval;
+    uint32_t _labelTime;
+};
+
+#endif
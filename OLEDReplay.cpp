@@ -0,0 +1,114 @@
+#include "OLEDReplay.h"
+
+#include "FourDuino.h"
+
+OLEDReplay::OLEDReplay(SerialContainer &transport)
+    : _transport(transport)
+{
+    memset(&_result, 0, sizeof(_result));
+}
+
+static uint32_t _readLong(const uint8_t *data)
+{
+    return (uint32_t)data[0] |
+        ((uint32_t)data[1] << 8) |
+        ((uint32_t)data[2] << 16) |
+        ((uint32_t)data[3] << 24);
+}
+
+bool OLEDReplay::run(const uint8_t *recording, uint32_t length)
+{
+    memset(&_result, 0, sizeof(_result));
+
+    uint32_t offset = 0;
+    if (length >= 5 && memcmp(recording, OLED_RECORDING_MAGIC, 4) == 0)
+    {
+        if (recording[4] != OLED_RECORDING_VERSION)
+            return false;
+        offset = 5;
+    }
+
+    bool first = true;
+    uint32_t firstStamp = 0;
+    uint32_t lastStamp = 0;
+    uint32_t start = micros();
+
+    while (offset < length)
+    {
+        if (offset + OLED_RECORDER_HEADER_SIZE > length)
+            return false;
+        uint8_t header = recording[offset];
+        uint32_t stamp = _readLong(recording + offset + 1);
+        uint8_t payload = header == OLED_RECORDING_BAUD
+            ? 4 : header & OLED_RECORDING_LENGTH_MASK;
+        const uint8_t *data = recording + offset + OLED_RECORDER_HEADER_SIZE;
+        offset += OLED_RECORDER_HEADER_SIZE + payload;
+        if (offset > length)
+            return false;
+
+        if (first)
+            firstStamp = stamp;
+        first = false;
+        lastStamp = stamp;
+
+        if (header == OLED_RECORDING_BAUD)
+            _transport.begin(_readLong(data));
+        else if (header & OLED_RECORDING_RX)
+            _receive(data, payload);
+        else
+        {
+            _transport.write(data, payload);
+            _result.bytesSent += payload;
+        }
+    }
+
+    _result.elapsedUs = micros() - start;
+    _result.recordedUs = lastStamp - firstStamp;
+    return true;
+}
+
+bool OLEDReplay::_receive(const uint8_t *expected, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (!_transport.waitForData(OLED_RESPONSE_TIMEOUT_MAX_US))
+        {
+            // Whatever was missing isn't coming; count it all and carry on.
+            _result.timeouts += length - i;
+            return false;
+        }
+        if (_transport.read() != expected[i])
+            _result.mismatches++;
+        _result.bytesReceived++;
+    }
+    return true;
+}
+
+const OLEDReplay::Result &OLEDReplay::getResult() { return _result; }
+
+uint32_t OLEDReplay::getThroughput()
+{
+    if (_result.elapsedUs == 0)
+        return 0;
+    uint64_t bytes = (uint64_t)_result.bytesSent + _result.bytesReceived;
+    return bytes * 1000000 / _result.elapsedUs;
+}
+
+void OLEDReplay::printReport(Print &out)
+{
+    out.print("sent=");
+    out.print(_result.bytesSent);
+    out.print(" received=");
+    out.print(_result.bytesReceived);
+    out.print(" mismatches=");
+    out.print(_result.mismatches);
+    out.print(" timeouts=");
+    out.print(_result.timeouts);
+    out.print(" replay=");
+    out.print(_result.elapsedUs);
+    out.print("us recorded=");
+    out.print(_result.recordedUs);
+    out.print("us throughput=");
+    out.print(getThroughput());
+    out.println(" B/s");
+}
@@ -0,0 +1,41 @@
+#ifndef OLEDReplay_h
+#define OLEDReplay_h
+
+#include "SerialContainers.h"
+#include "RecordingSerialContainer.h"
+
+// Plays a recording from RecordingSerialContainer back through a transport as fast as the
+// display allows: sent chunks are written as-is, and each received chunk is waited for
+// and compared with what was recorded. The result is a repeatable throughput figure for
+// a real screen's traffic.
+class OLEDReplay
+{
+public:
+    struct Result
+    {
+        uint32_t bytesSent;
+        uint32_t bytesReceived;
+        uint32_t mismatches;    // Received bytes that differ from the recording
+        uint32_t timeouts;      // Received bytes that never arrived
+        uint32_t elapsedUs;     // Time the replay took
+        uint32_t recordedUs;    // Time the original session took
+    };
+
+    OLEDReplay(SerialContainer &transport);
+
+    // Plays back a recording held in memory, with or without its "4DRC" header.
+    // Returns false if the recording is malformed.
+    bool run(const uint8_t *recording, uint32_t length);
+    const Result &getResult();
+    // Bytes per second, both directions
+    uint32_t getThroughput();
+    void printReport(Print &out);
+
+private:
+    bool _receive(const uint8_t *expected, uint8_t length);
+
+    SerialContainer &_transport;
+    Result _result;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "OLEDSDAllocator.h"
+
+#define HEADER_SIZE     12  // Magic, data sectors, extent count, reserved, checksum
+#define EXTENT_SIZE     10  // Start, length, tag
+#define MAX_EXTENTS     ((OLED_SD_SECTOR_SIZE - HEADER_SIZE) / EXTENT_SIZE)
+
+OLEDSDAllocator::OLEDSDAllocator(OLED &oled, uint32_t firstSector, uint32_t sectorCount,
+    uint8_t capacity)
+    : _oled(oled), _firstSector(firstSector), _sectorCount(sectorCount > 0 ? sectorCount - 1 : 0),
+    _count(0)
+{
+    _capacity = min(capacity, (uint8_t)MAX_EXTENTS);
+    _extents = new Extent[_capacity];
+}
+
+OLEDSDAllocator::~OLEDSDAllocator()
+{
+    delete[] _extents;
+}
+
+bool OLEDSDAllocator::begin()
+{
+    bool valid;
+    if (!_load(valid))
+        return false;
+    return valid || format();
+}
+
+bool OLEDSDAllocator::format()
+{
+    _count = 0;
+    return _save();
+}
+
+uint8_t OLEDSDAllocator::getExtentCount() { return _count; }
+
+
+//
+// Allocation
+//
+
+bool OLEDSDAllocator::allocate(uint32_t sectors, uint32_t &sectorAddress, uint16_t tag)
+{
+    uint32_t start;
+    if (!_extents || sectors == 0 || _count >= _capacity)
+        return false;
+    int16_t index = _findFree(sectors, start);
+    if (index < 0)
+        return false;
+
+    for (uint8_t e = _count; e > index; e--)
+        _extents[e] = _extents[e - 1];
+    _extents[index].start = start;
+    _extents[index].length = sectors;
+    _extents[index].tag = tag;
+    _count++;
+
+    if (!_save())
+    {
+        // Keep the table in step with the card.
+        _count--;
+        for (uint8_t e = index; e < _count; e++)
+            _extents[e] = _extents[e + 1];
+        return false;
+    }
+    sectorAddress = _firstSector + 1 + start;
+    return true;
+}
+
+bool OLEDSDAllocator::allocateImage(uint16_t width, uint16_t height, uint32_t &sectorAddress,
+    uint16_t tag)
+{
+    return allocate(OLED::SDGetImageSectors(width, height), sectorAddress, tag);
+}
+
+bool OLEDSDAllocator::free(uint32_t sectorAddress)
+{
+    for (uint8_t index = 0; index < _count; index++)
+    {
+        if (_firstSector + 1 + _extents[index].start != sectorAddress)
+            continue;
+
+        Extent freed = _extents[index];
+        _count--;
+        for (uint8_t e = index; e < _count; e++)
+            _extents[e] = _extents[e + 1];
+
+        if (!_save())
+        {
+            for (uint8_t e = _count; e > index; e--)
+                _extents[e] = _extents[e - 1];
+            _extents[index] = freed;
+            _count++;
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool OLEDSDAllocator::find(uint16_t tag, uint32_t &sectorAddress)
+{
+    uint32_t sectors;
+    return find(tag, sectorAddress, sectors);
+}
+
+bool OLEDSDAllocator::find(uint16_t tag, uint32_t &sectorAddress, uint32_t &sectors)
+{
+    for (uint8_t e = 0; e < _count; e++)
+    {
+        if (_extents[e].tag == tag)
+        {
+            sectorAddress = _firstSector + 1 + _extents[e].start;
+            sectors = _extents[e].length;
+            return true;
+        }
+    }
+    return false;
+}
+
+// First gap big enough: returns where the new extent goes in the table, or -1.
+int16_t OLEDSDAllocator::_findFree(uint32_t sectors, uint32_t &start)
+{
+    uint32_t gapStart = 0;
+    for (uint8_t e = 0; e < _count; e++)
+    {
+        if (_extents[e].start - gapStart >= sectors)
+        {
+            start = gapStart;
+            return e;
+        }
+        gapStart = _extents[e].start + _extents[e].length;
+    }
+    if (_sectorCount - gapStart >= sectors)
+    {
+        start = gapStart;
+        return _count;
+    }
+    return -1;
+}
+
+uint32_t OLEDSDAllocator::getFreeSectors()
+{
+    uint32_t used = 0;
+    for (uint8_t e = 0; e < _count; e++)
+        used += _extents[e].length;
+    return _sectorCount - used;
+}
+
+uint32_t OLEDSDAllocator::getLargestFree()
+{
+    uint32_t largest = 0;
+    uint32_t gapStart = 0;
+    for (uint8_t e = 0; e < _count; e++)
+    {
+        largest = max(largest, _extents[e].start - gapStart);
+        gapStart = _extents[e].start + _extents[e].length;
+    }
+    return max(largest, _sectorCount - gapStart);
+}
+
+
+//
+// Compaction
+//
+
+bool OLEDSDAllocator::compact()
+{
+    uint8_t *buffer = 0;
+    uint32_t next = 0;
+    bool success = true;
+    for (uint8_t e = 0; e < _count && success; e++)
+    {
+        Extent &extent = _extents[e];
+        if (extent.start != next)
+        {
+            if (!buffer && !(buffer = new uint8_t[OLED_SD_SECTOR_SIZE]))
+                return false;
+            success = _copySectors(extent.start, next, extent.length, buffer);
+            if (success)
+            {
+                extent.start = next;
+                success = _save();
+            }
+        }
+        next = extent.start + extent.length;
+    }
+    delete[] buffer;
+    return success;
+}
+
+// Always moves data down, so copying forwards is safe when the ranges overlap.
+bool OLEDSDAllocator::_copySectors(uint32_t from, uint32_t to, uint32_t count, uint8_t *buffer)
+{
+    uint32_t base = _firstSector + 1;
+    for (uint32_t s = 0; s < count; s++)
+    {
+        if (!_oled.SDReadSector(base + from + s, buffer) ||
+            !_oled.SDWriteSector(base + to + s, buffer))
+            return false;
+    }
+    return true;
+}
+
+
+//
+// Header sector
+//
+
+// Reads the header a few bytes at a time through the address pointer, so no sector buffer
+// is needed. False if the card couldn't be read, or if the table has more extents than
+// we have room for (or no room at all): replacing it would throw away extents that are
+// in use.
+bool OLEDSDAllocator::_load(bool &valid)
+{
+    valid = false;
+    _count = 0;
+    if (!_extents)
+        return false;
+    uint32_t magic, sectorCount;
+    uint8_t count, reserved;
+    uint16_t checksum;
+    if (!_oled.SDSetAddressPointer(_firstSector * OLED_SD_SECTOR_SIZE) ||
+        !_oled.SDReadLong(magic) || !_oled.SDReadLong(sectorCount) ||
+        !_oled.SDRead(count) || !_oled.SDRead(reserved) || !_oled.SDReadShort(checksum))
+        return false;
+    if (magic != OLED_SD_ALLOCATOR_MAGIC || sectorCount != _sectorCount ||
+        count > MAX_EXTENTS)
+        return true;
+    if (count > _capacity)
+        return false;
+
+    for (uint8_t e = 0; e < count; e++)
+    {
+        Extent &extent = _extents[e];
+        if (!_oled.SDReadLong(extent.start) || !_oled.SDReadLong(extent.length) ||
+            !_oled.SDReadShort(extent.tag))
+            return false;
+    }
+    _count = count;
+    if (_checksum() != checksum)
+    {
+        _count = 0;
+        return true;
+    }
+
+    // Extents must be in order, and inside the range.
+    uint32_t end = 0;
+    for (uint8_t e = 0; e < _count; e++)
+    {
+        if (_extents[e].start < end || _extents[e].length > _sectorCount - _extents[e].start)
+        {
+            _count = 0;
+            return true;
+        }
+        end = _extents[e].start + _extents[e].length;
+    }
+    valid = true;
+    return true;
+}
+
+// Streams the header straight into the sector, padded with zeros. Waits for the ACK even
+// when pipelined, since allocate and free roll back on a failed save.
+bool OLEDSDAllocator::_save()
+{
+    uint16_t errors = _oled.getPipelineErrors();
+    _oled.write(5, OLED_CMD_EXTENDED_SD, OLED_CMD_SD_WRITE_SECTOR_BLOCK,
+        OLEDUtil::getByte(_firstSector, 2),
+        OLEDUtil::getByte(_firstSector, 1),
+        OLEDUtil::getByte(_firstSector));
+    _oled.writeLong(OLED_SD_ALLOCATOR_MAGIC);
+    _oled.writeLong(_sectorCount);
+    _oled.write(2, _count, 0);
+    _oled.writeShort(_checksum());
+    for (uint8_t e = 0; e < _count; e++)
+    {
+        _oled.writeLong(_extents[e].start);
+        _oled.writeLong(_extents[e].length);
+        _oled.writeShort(_extents[e].tag);
+    }
+    for (uint16_t b = HEADER_SIZE + _count * EXTENT_SIZE; b < OLED_SD_SECTOR_SIZE; b++)
+        _oled.write((uint8_t)0);
+    bool result = _oled.getAck();
+    _oled.drainPipeline();
+    return result && _oled.getPipelineErrors() == errors;
+}
+
+uint16_t OLEDSDAllocator::_checksum()
+{
+    uint16_t sum = _count;
+    for (uint8_t e = 0; e < _count; e++)
+    {
+        uint16_t words[5] = { (uint16_t)(_extents[e].start >> 16), (uint16_t)_extents[e].start,
+            (uint16_t)(_extents[e].length >> 16), (uint16_t)_extents[e].length, _extents[e].tag };
+        for (uint8_t w = 0; w < 5; w++)
+            sum = (uint16_t)((sum << 1) | (sum >> 15)) + words[w];
+    }
+    return sum;
+}
@@ -0,0 +1,91 @@
+#ifndef OLEDSDAllocator_h
+#define OLEDSDAllocator_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+
+#define OLED_SD_ALLOCATOR_EXTENTS   16          // Extents tracked by default (10 bytes each, max 50)
+#define OLED_SD_ALLOCATOR_MAGIC     0x34444131  // "4DA1" at the start of the header sector
+
+//
+// SD sector allocator
+//
+// Hands out contiguous runs of sectors ("extents") from a range of the raw card, for
+// images and screens written with SDWriteImage/SDWriteScreen. The first sector of the
+// range is a header holding the table of extents, rewritten after every change, so
+// whatever was stored is still there after a reset: give each extent a tag and find()
+// it again on the next boot.
+//
+// Only allocated extents are stored, sorted by address; the free extents are the gaps
+// between them.
+//
+//   OLEDSDAllocator sd(oled, 1000, 4000);
+//   sd.begin();
+//   uint32_t sector;
+//   if (!sd.find(LOGO, sector) && sd.allocateImage(64, 64, sector, LOGO))
+//       oled.SDWriteImage(sector, 64, 64, logo);
+//   oled.SDDrawImage(sector, 0, 0, 64, 64);
+//
+// Call SDInitialize() first.
+//
+class OLEDSDAllocator
+{
+public:
+    // The range includes the header sector.
+    OLEDSDAllocator(OLED &oled, uint32_t firstSector, uint32_t sectorCount,
+        uint8_t capacity = OLED_SD_ALLOCATOR_EXTENTS);
+    ~OLEDSDAllocator();
+
+    // Loads the table from the header sector. A header that isn't there, is damaged, or
+    // was written for a different range is replaced with an empty table. Fails, leaving the
+    // card alone, if the table holds more extents than this allocator's capacity, or if
+    // there was no memory for the table at all.
+    bool begin();
+    // Frees everything.
+    bool format();
+
+    // Finds room for `sectors` sectors (first fit) and returns the absolute address of the first.
+    bool allocate(uint32_t sectors, uint32_t &sectorAddress, uint16_t tag = 0);
+    // Room for a 16 bit image, as written by SDWriteImage
+    bool allocateImage(uint16_t width, uint16_t height, uint32_t &sectorAddress, uint16_t tag = 0);
+    // Takes the address allocate() returned.
+    bool free(uint32_t sectorAddress);
+    // Finds the first extent with the given tag.
+    bool find(uint16_t tag, uint32_t &sectorAddress);
+    bool find(uint16_t tag, uint32_t &sectorAddress, uint32_t &sectors);
+
+    // Slides every extent down towards the header, copying its sectors, so all the free
+    // space ends up in one piece at the end. Extents that move get new addresses: look
+    // them up again with find(). Needs a 512 byte buffer while it runs.
+    // The table is saved after each extent is copied; a reset while copying an extent
+    // that overlaps its old position can leave that one extent damaged.
+    bool compact();
+
+    uint8_t getExtentCount();
+    uint32_t getFreeSectors();
+    uint32_t getLargestFree();
+
+private:
+    struct Extent
+    {
+        uint32_t start;     // Relative to the first data sector
+        uint32_t length;
+        uint16_t tag;
+    };
+
+    bool _load(bool &valid);
+    bool _save();
+    uint16_t _checksum();
+    int16_t _findFree(uint32_t sectors, uint32_t &start);
+    bool _copySectors(uint32_t from, uint32_t to, uint32_t count, uint8_t *buffer);
+
+    OLED &_oled;
+    uint32_t _firstSector;  // The header; data starts at the next sector
+    uint32_t _sectorCount;  // Data sectors, not counting the header
+    Extent *_extents;
+    uint8_t _capacity;
+    uint8_t _count;
+};
+
+#endif
@@ -0,0 +1,294 @@
+#include "OLEDShadow.h"
+
+OLEDShadow::OLEDShadow(uint16_t width, uint16_t height)
+{
+    _init(0, 0, width, height, 0);
+}
+
+OLEDShadow::OLEDShadow(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t scaleShift)
+{
+    _init(x, y, width, height, scaleShift);
+}
+
+void OLEDShadow::_init(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t scaleShift)
+{
+    _x = x;
+    _y = y;
+    _width = width;
+    _height = height;
+    _scaleShift = scaleShift;
+    uint16_t cell = 1 << scaleShift;
+    _stride = (width + cell - 1) >> scaleShift;
+    uint16_t rows = (height + cell - 1) >> scaleShift;
+    _buffer = new uint16_t[(uint32_t)_stride * rows];
+    _pixelsWritten = 0;
+    _unknownCount = 0;
+    if (_buffer)
+        clear(0x0000);
+}
+
+OLEDShadow::~OLEDShadow()
+{
+    delete[] _buffer;
+}
+
+bool OLEDShadow::isAllocated() { return _buffer != 0; }
+bool OLEDShadow::isExact() { return _scaleShift == 0; }
+uint16_t OLEDShadow::getX() { return _x; }
+uint16_t OLEDShadow::getY() { return _y; }
+uint16_t OLEDShadow::getWidth() { return _width; }
+uint16_t OLEDShadow::getHeight() { return _height; }
+const uint16_t *OLEDShadow::getBuffer() { return _buffer; }
+uint32_t OLEDShadow::getPixelsWritten() { return _pixelsWritten; }
+void OLEDShadow::clearPixelsWritten() { _pixelsWritten = 0; }
+
+bool OLEDShadow::contains(uint16_t x, uint16_t y)
+{
+    return _buffer && x >= _x && y >= _y && x - _x < _width && y - _y < _height;
+}
+
+bool OLEDShadow::getPixel(uint16_t x, uint16_t y, uint16_t &color)
+{
+    if (!contains(x, y) || _isUnknown(x, y))
+        return false;
+    color = _buffer[(uint32_t)((y - _y) >> _scaleShift) * _stride + ((x - _x) >> _scaleShift)];
+    return true;
+}
+
+
+//
+// Drawing
+//
+
+void OLEDShadow::clear(uint16_t background)
+{
+    _unknownCount = 0;
+    drawRectangle(_x, _y, _x + _width - 1, _y + _height - 1, background, true);
+}
+
+void OLEDShadow::drawPixel(int32_t x, int32_t y, uint16_t color)
+{
+    if (!_buffer || x < _x || y < _y || x - _x >= _width || y - _y >= _height)
+        return;
+    _buffer[(uint32_t)((y - _y) >> _scaleShift) * _stride + ((x - _x) >> _scaleShift)] = color;
+    _pixelsWritten++;
+}
+
+void OLEDShadow::drawLine(int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color)
+{
+    int32_t dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+    int32_t dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+    int32_t error = dx + dy;
+    while (true)
+    {
+        drawPixel(x1, y1, color);
+        if (x1 == x2 && y1 == y2)
+            break;
+        int32_t error2 = 2 * error;
+        if (error2 >= dy) { error += dy; x1 += sx; }
+        if (error2 <= dx) { error += dx; y1 += sy; }
+    }
+}
+
+void OLEDShadow::drawRectangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color,
+    bool filled)
+{
+    if (x1 > x2) { int32_t t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { int32_t t = y1; y1 = y2; y2 = t; }
+    if (!filled)
+    {
+        drawLine(x1, y1, x2, y1, color);
+        drawLine(x2, y1, x2, y2, color);
+        drawLine(x2, y2, x1, y2, color);
+        drawLine(x1, y2, x1, y1, color);
+        return;
+    }
+
+    // Solid fills go cell by cell rather than pixel by pixel.
+    _forgetUnknown(x1, y1, x2, y2);
+    x1 = max(x1, (int32_t)_x);
+    y1 = max(y1, (int32_t)_y);
+    x2 = min(x2, (int32_t)_x + _width - 1);
+    y2 = min(y2, (int32_t)_y + _height - 1);
+    if (!_buffer || x1 > x2 || y1 > y2)
+        return;
+    _pixelsWritten += (uint32_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+    for (int32_t row = (y1 - _y) >> _scaleShift; row <= (y2 - _y) >> _scaleShift; row++)
+    {
+        uint16_t *cell = _buffer + (uint32_t)row * _stride + ((x1 - _x) >> _scaleShift);
+        for (int32_t col = (x1 - _x) >> _scaleShift; col <= (x2 - _x) >> _scaleShift; col++)
+            *cell++ = color;
+    }
+}
+
+void OLEDShadow::drawTriangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3,
+    uint16_t color, bool filled)
+{
+    int32_t area = (x2 - x1) * (y3 - y1) - (y2 - y1) * (x3 - x1);
+    if (!filled || area == 0)
+    {
+        drawLine(x1, y1, x2, y2, color);
+        drawLine(x2, y2, x3, y3, color);
+        drawLine(x3, y3, x1, y1, color);
+        return;
+    }
+    int32_t minX = min(x1, min(x2, x3)), maxX = max(x1, max(x2, x3));
+    int32_t minY = min(y1, min(y2, y3)), maxY = max(y1, max(y2, y3));
+    for (int32_t y = minY; y <= maxY; y++)
+    {
+        for (int32_t x = minX; x <= maxX; x++)
+        {
+            int32_t w1 = (x2 - x1) * (y - y1) - (y2 - y1) * (x - x1);
+            int32_t w2 = (x3 - x2) * (y - y2) - (y3 - y2) * (x - x2);
+            int32_t w3 = (x1 - x3) * (y - y3) - (y1 - y3) * (x - x3);
+            if ((w1 >= 0 && w2 >= 0 && w3 >= 0) || (w1 <= 0 && w2 <= 0 && w3 <= 0))
+                drawPixel(x, y, color);
+        }
+    }
+}
+
+void OLEDShadow::drawCircle(int32_t cx, int32_t cy, int32_t radius, uint16_t color, bool filled)
+{
+    int32_t x = radius, y = 0;
+    int32_t error = 1 - radius;
+    while (x >= y)
+    {
+        if (filled)
+        {
+            drawRectangle(cx - x, cy + y, cx + x, cy + y, color, true);
+            drawRectangle(cx - x, cy - y, cx + x, cy - y, color, true);
+            drawRectangle(cx - y, cy + x, cx + y, cy + x, color, true);
+            drawRectangle(cx - y, cy - x, cx + y, cy - x, color, true);
+        }
+        else
+        {
+            drawPixel(cx + x, cy + y, color); drawPixel(cx - x, cy + y, color);
+            drawPixel(cx + x, cy - y, color); drawPixel(cx - x, cy - y, color);
+            drawPixel(cx + y, cy + x, color); drawPixel(cx - y, cy + x, color);
+            drawPixel(cx + y, cy - x, color); drawPixel(cx - y, cy - x, color);
+        }
+        y++;
+        if (error < 0)
+            error += 2 * y + 1;
+        else
+        {
+            x--;
+            error += 2 * (y - x) + 1;
+        }
+    }
+}
+
+void OLEDShadow::replaceColor(int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+    uint16_t oldColor, uint16_t newColor)
+{
+    x1 = max(x1, (int32_t)_x);
+    y1 = max(y1, (int32_t)_y);
+    x2 = min(x2, (int32_t)_x + _width - 1);
+    y2 = min(y2, (int32_t)_y + _height - 1);
+    if (!_buffer || x1 > x2 || y1 > y2)
+        return;
+    _pixelsWritten += (uint32_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+    for (int32_t row = (y1 - _y) >> _scaleShift; row <= (y2 - _y) >> _scaleShift; row++)
+    {
+        uint16_t *cell = _buffer + (uint32_t)row * _stride + ((x1 - _x) >> _scaleShift);
+        for (int32_t col = (x1 - _x) >> _scaleShift; col <= (x2 - _x) >> _scaleShift; col++, cell++)
+        {
+            if (*cell == oldColor)
+                *cell = newColor;
+        }
+    }
+}
+
+void OLEDShadow::copyPaste(int32_t sourceX, int32_t sourceY, int32_t destX, int32_t destY,
+    int32_t width, int32_t height)
+{
+    if (!_buffer || width <= 0 || height <= 0)
+        return;
+
+    // Anything copied from outside the region, or from an unknown area, is unknown.
+    bool sourceKnown = sourceX >= _x && sourceY >= _y &&
+        sourceX + width <= _x + _width && sourceY + height <= _y + _height;
+    for (uint8_t u = 0; u < _unknownCount && sourceKnown; u++)
+    {
+        sourceKnown = _unknown[u].x1 > sourceX + width - 1 || _unknown[u].x2 < sourceX ||
+            _unknown[u].y1 > sourceY + height - 1 || _unknown[u].y2 < sourceY;
+    }
+
+    // Copy through a temporary buffer so overlapping areas behave.
+    uint16_t *copy = new uint16_t[(uint32_t)width * height];
+    if (!copy)
+    {
+        markUnknown(destX, destY, destX + width - 1, destY + height - 1);
+        return;
+    }
+    for (int32_t y = 0; y < height; y++)
+    {
+        for (int32_t x = 0; x < width; x++)
+        {
+            int32_t px = sourceX + x, py = sourceY + y;
+            copy[(uint32_t)y * width + x] =
+                px >= _x && py >= _y && px - _x < _width && py - _y < _height
+                ? _buffer[(uint32_t)((py - _y) >> _scaleShift) * _stride + ((px - _x) >> _scaleShift)]
+                : 0x0000;
+        }
+    }
+    for (int32_t y = 0; y < height; y++)
+        for (int32_t x = 0; x < width; x++)
+            drawPixel(destX + x, destY + y, copy[(uint32_t)y * width + x]);
+    delete[] copy;
+
+    if (!sourceKnown)
+        markUnknown(destX, destY, destX + width - 1, destY + height - 1);
+}
+
+
+//
+// Unknown areas
+//
+
+void OLEDShadow::markUnknown(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    x1 = max(x1, (int32_t)_x);
+    y1 = max(y1, (int32_t)_y);
+    x2 = min(x2, (int32_t)_x + _width - 1);
+    y2 = min(y2, (int32_t)_y + _height - 1);
+    if (x1 > x2 || y1 > y2)
+        return;
+
+    if (_unknownCount < OLED_SHADOW_UNKNOWN_RECTS)
+    {
+        Rect &rect = _unknown[_unknownCount++];
+        rect.x1 = x1; rect.y1 = y1; rect.x2 = x2; rect.y2 = y2;
+        return;
+    }
+    // Out of slots: grow the last one to cover this too.
+    Rect &last = _unknown[_unknownCount - 1];
+    last.x1 = min((int32_t)last.x1, x1);
+    last.y1 = min((int32_t)last.y1, y1);
+    last.x2 = max((int32_t)last.x2, x2);
+    last.y2 = max((int32_t)last.y2, y2);
+}
+
+bool OLEDShadow::_isUnknown(uint16_t x, uint16_t y)
+{
+    for (uint8_t u = 0; u < _unknownCount; u++)
+    {
+        if (x >= _unknown[u].x1 && x <= _unknown[u].x2 &&
+            y >= _unknown[u].y1 && y <= _unknown[u].y2)
+            return true;
+    }
+    return false;
+}
+
+// Unknown areas completely painted over are known again.
+void OLEDShadow::_forgetUnknown(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    for (uint8_t u = 0; u < _unknownCount; )
+    {
+        if (x1 <= _unknown[u].x1 && y1 <= _unknown[u].y1 &&
+            x2 >= _unknown[u].x2 && y2 >= _unknown[u].y2)
+            _unknown[u] = _unknown[--_unknownCount];
+        else
+            u++;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef OLEDShadow_h
+#define OLEDShadow_h
+
+#include <Arduino.h>
+
+#define OLED_SHADOW_UNKNOWN_RECTS   4   // Areas with unknown contents (text, SD images...) tracked
+
+//
+// Shadow framebuffer
+//
+// A copy of (part of) the screen kept in RAM by replaying every drawing command locally,
+// so OLED::readPixel can answer without a round trip. Attach one with OLED::setShadow().
+//
+// Memory is width * height * 2 bytes. A whole Picaso screen is fine on a host; on AVR,
+// shadow just a region, or a reduced resolution: with scaleShift n each stored pixel
+// stands for a 2^n by 2^n block, holding whatever was drawn there last.
+//
+// Things the library can't reproduce exactly (text, user bitmaps, SD images) leave their
+// area marked unknown until something solid is drawn over it; reads there go to the display.
+//
+class OLEDShadow
+{
+public:
+    OLEDShadow(uint16_t width, uint16_t height);
+    OLEDShadow(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t scaleShift = 0);
+    ~OLEDShadow();
+
+    // False if the buffer couldn't be allocated
+    bool isAllocated();
+    bool isExact();
+    uint16_t getX();
+    uint16_t getY();
+    uint16_t getWidth();
+    uint16_t getHeight();
+    // Inside the shadowed region
+    bool contains(uint16_t x, uint16_t y);
+    // Gets a shadowed pixel; false if it's outside the region or unknown.
+    bool getPixel(uint16_t x, uint16_t y, uint16_t &color);
+    const uint16_t *getBuffer();
+
+    // Mirrored drawing. Shapes are rasterized the same way EmulatorSerialContainer draws them.
+    void clear(uint16_t background);
+    void drawPixel(int32_t x, int32_t y, uint16_t color);
+    void drawLine(int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color);
+    void drawRectangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color, bool filled);
+    void drawTriangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3,
+        uint16_t color, bool filled);
+    void drawCircle(int32_t x, int32_t y, int32_t radius, uint16_t color, bool filled);
+    void replaceColor(int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+        uint16_t oldColor, uint16_t newColor);
+    void copyPaste(int32_t sourceX, int32_t sourceY, int32_t destX, int32_t destY,
+        int32_t width, int32_t height);
+    void markUnknown(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+
+    // Pixel writes that landed in the region; the emulator uses this as its drawing cost.
+    uint32_t getPixelsWritten();
+    void clearPixelsWritten();
+
+private:
+    void _init(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t scaleShift);
+    bool _isUnknown(uint16_t x, uint16_t y);
+    void _forgetUnknown(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+
+    uint16_t _x;
+    uint16_t _y;
+    uint16_t _width;    // Full-resolution size of the region
+    uint16_t _height;
+    uint8_t _scaleShift;
+    uint16_t _stride;   // Stored pixels per row
+    uint16_t *_buffer;
+    uint32_t _pixelsWritten;
+
+    struct Rect
+    {
+        int16_t x1, y1, x2, y2;
+    };
+    Rect _unknown[OLED_SHADOW_UNKNOWN_RECTS];
+    uint8_t _unknownCount;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "OLEDSpriteCache.h"
+
+OLEDSpriteCache::OLEDSpriteCache(OLED &oled, uint32_t firstSector, uint32_t sectorCount,
+    uint8_t capacity)
+    : _oled(oled), _firstSector(firstSector), _sectorCount(sectorCount), _capacity(capacity)
+{
+    _entries = new Entry[capacity];
+    clear();
+}
+
+OLEDSpriteCache::~OLEDSpriteCache()
+{
+    delete[] _entries;
+}
+
+void OLEDSpriteCache::clear()
+{
+    for (uint8_t e = 0; e < _capacity; e++)
+        _entries[e].valid = false;
+    _nextSector = 0;
+    _clock = 0;
+    _hits = 0;
+    _uploads = 0;
+}
+
+uint32_t OLEDSpriteCache::getHits() { return _hits; }
+uint32_t OLEDSpriteCache::getUploads() { return _uploads; }
+
+bool OLEDSpriteCache::draw(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+    const uint16_t *pixels)
+{
+    return _draw(x, y, width, height, pixels, false);
+}
+
+bool OLEDSpriteCache::draw_P(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+    const uint16_t *pixels)
+{
+    return _draw(x, y, width, height, pixels, true);
+}
+
+bool OLEDSpriteCache::_draw(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+    const uint16_t *pixels, bool progmem)
+{
+    if (width < 1 || height < 1)
+        return false;
+
+    uint32_t hash = _hash(width, height, pixels, progmem);
+    Entry *entry = _find(hash, width, height);
+    if (entry)
+        _hits++;
+    else
+    {
+        entry = _allocate(OLED::SDGetImageSectors(width, height));
+        if (!entry)
+            return progmem
+                ? _oled.drawImage16Bit_P(x, y, width, height, pixels)
+                : _oled.drawImage16Bit(x, y, width, height, pixels);
+
+        // Pipelined or async, the sector writes may still be awaiting their ACKs. Only
+        // cache an upload once they are all in.
+        uint16_t errors = _oled.getPipelineErrors();
+        bool uploaded = progmem
+            ? _oled.SDWriteImage_P(_firstSector + entry->sector, width, height, pixels)
+            : _oled.SDWriteImage(_firstSector + entry->sector, width, height, pixels);
+        _oled.drainPipeline();
+        if (!uploaded || _oled.getPipelineErrors() != errors)
+            return false;
+        entry->hash = hash;
+        entry->width = width;
+        entry->height = height;
+        entry->valid = true;
+        _uploads++;
+    }
+    entry->lastUsed = ++_clock;
+    return _oled.SDDrawImage(_firstSector + entry->sector, x, y, width, height);
+}
+
+// FNV-1a over the size and the pixels
+uint32_t OLEDSpriteCache::_hash(uint16_t width, uint16_t height, const uint16_t *pixels,
+    bool progmem)
+{
+    uint32_t hash = 2166136261UL;
+    uint16_t words[2] = { width, height };
+    for (uint8_t w = 0; w < 2; w++)
+    {
+        hash = (hash ^ (words[w] & 0xFF)) * 16777619UL;
+        hash = (hash ^ (words[w] >> 8)) * 16777619UL;
+    }
+    uint32_t pixelCount = (uint32_t)width * height;
+    for (uint32_t p = 0; p < pixelCount; p++)
+    {
+        uint16_t pixel = progmem ? pgm_read_word(pixels + p) : pixels[p];
+        hash = (hash ^ (pixel & 0xFF)) * 16777619UL;
+        hash = (hash ^ (pixel >> 8)) * 16777619UL;
+    }
+    return hash;
+}
+
+OLEDSpriteCache::Entry *OLEDSpriteCache::_find(uint32_t hash, uint16_t width, uint16_t height)
+{
+    for (uint8_t e = 0; e < _capacity; e++)
+    {
+        Entry &entry = _entries[e];
+        if (entry.valid && entry.hash == hash && entry.width == width && entry.height == height)
+            return &entry;
+    }
+    return 0;
+}
+
+// Takes the next `sectors` sectors of the ring, forgetting any sprite stored there,
+// and the entry that was free or least recently used.
+OLEDSpriteCache::Entry *OLEDSpriteCache::_allocate(uint32_t sectors)
+{
+    if (!_entries || _capacity == 0 || sectors > _sectorCount)
+        return 0;
+    if (_nextSector + sectors > _sectorCount)
+        _nextSector = 0;
+    uint32_t start = _nextSector;
+    _nextSector += sectors;
+
+    Entry *oldest = 0;
+    for (uint8_t e = 0; e < _capacity; e++)
+    {
+        Entry &entry = _entries[e];
+        if (entry.valid)
+        {
+            uint32_t end = entry.sector + OLED::SDGetImageSectors(entry.width, entry.height);
+            if (entry.sector < start + sectors && start < end)
+                entry.valid = false;
+        }
+        if (!oldest || (oldest->valid && (!entry.valid ||
+            (uint16_t)(_clock - entry.lastUsed) > (uint16_t)(_clock - oldest->lastUsed))))
+            oldest = &entry;
+    }
+    oldest->sector = start;
+    oldest->valid = false;
+    return oldest;
+}
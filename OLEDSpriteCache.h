@@ -0,0 +1,70 @@
+#ifndef OLEDSpriteCache_h
+#define OLEDSpriteCache_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+
+#define OLED_SPRITE_CACHE_ENTRIES   16  // Sprites remembered by default (16 bytes each)
+
+//
+// SD sprite cache
+//
+// Draws 16 bit images by uploading them to the SD card the first time they're seen and
+// drawing them from there with SDDrawImage afterwards: about a dozen bytes per draw
+// instead of two per pixel. Sprites are recognised by a hash of their size and contents,
+// so a changed image is uploaded again and an unchanged one never is.
+//
+// The cache owns a range of sectors and fills it like a ring; whatever gets overwritten
+// is forgotten. Nothing is remembered across resets. Call SDInitialize() first.
+//
+//   OLEDSpriteCache sprites(oled, 1000, 200);
+//   sprites.draw_P(x, y, 16, 16, icon);
+//
+// Sprites too big for the cache are drawn directly. With pipelining or async mode on, a
+// first draw still waits for its upload to be confirmed before the sprite is cached.
+//
+class OLEDSpriteCache
+{
+public:
+    OLEDSpriteCache(OLED &oled, uint32_t firstSector, uint32_t sectorCount,
+        uint8_t capacity = OLED_SPRITE_CACHE_ENTRIES);
+    ~OLEDSpriteCache();
+
+    bool draw(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels);
+    bool draw_P(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels);
+    // Forgets everything, e.g. after the card was changed or written over.
+    void clear();
+
+    uint32_t getHits();
+    uint32_t getUploads();
+
+private:
+    struct Entry
+    {
+        uint32_t hash;
+        uint32_t sector;    // Relative to the cache's first sector
+        uint16_t width;
+        uint16_t height;
+        uint16_t lastUsed;
+        bool valid;
+    };
+
+    bool _draw(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels,
+        bool progmem);
+    static uint32_t _hash(uint16_t width, uint16_t height, const uint16_t *pixels, bool progmem);
+    Entry *_find(uint32_t hash, uint16_t width, uint16_t height);
+    Entry *_allocate(uint32_t sectors);
+
+    OLED &_oled;
+    uint32_t _firstSector;
+    uint32_t _sectorCount;
+    uint32_t _nextSector;
+    Entry *_entries;
+    uint8_t _capacity;
+    uint16_t _clock;
+    uint32_t _hits;
+    uint32_t _uploads;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "OLEDTelemetry.h"
+
+#include "FourDuino.h"
+
+#define OLED_TELEMETRY_NONE 0xFF
+
+OLEDTelemetry::OLEDTelemetry()
+{
+    clear();
+}
+
+void OLEDTelemetry::clear()
+{
+    _opcodeCount = 0;
+    _current = OLED_TELEMETRY_NONE;
+    clearInFlight();
+}
+
+void OLEDTelemetry::clearInFlight()
+{
+    _inFlightHead = 0;
+    _inFlightCount = 0;
+}
+
+uint8_t OLEDTelemetry::getOpcodeCount() { return _opcodeCount; }
+
+const OLEDTelemetry::OpcodeStats *OLEDTelemetry::getStats(uint8_t index)
+{
+    return index < _opcodeCount ? &_stats[index] : 0;
+}
+
+const OLEDTelemetry::OpcodeStats *OLEDTelemetry::findStats(uint8_t opcode, uint8_t subcode)
+{
+    if (opcode != OLED_CMD_EXTENDED_SD)
+        subcode = 0;
+    for (uint8_t i = 0; i < _opcodeCount; i++)
+        if (_stats[i].opcode == opcode && _stats[i].subcode == subcode)
+            return &_stats[i];
+    return 0;
+}
+
+uint32_t OLEDTelemetry::getBucketLimitUs(uint8_t bucket)
+{
+    if (bucket >= OLED_TELEMETRY_LATENCY_BUCKETS - 1)
+        return 0xFFFFFFFF;
+    return (uint32_t)OLED_TELEMETRY_FIRST_BUCKET_US << bucket;
+}
+
+OLEDTelemetry::OpcodeStats *OLEDTelemetry::_getOrAdd(uint8_t opcode, uint8_t subcode)
+{
+    OpcodeStats *stats = (OpcodeStats *)findStats(opcode, subcode);
+    if (stats || _opcodeCount >= OLED_TELEMETRY_MAX_OPCODES)
+        return stats;
+
+    stats = &_stats[_opcodeCount++];
+    memset(stats, 0, sizeof(OpcodeStats));
+    stats->opcode = opcode;
+    stats->subcode = opcode == OLED_CMD_EXTENDED_SD ? subcode : 0;
+    return stats;
+}
+
+void OLEDTelemetry::commandSent(uint8_t opcode, uint8_t subcode, uint16_t bytes)
+{
+    OpcodeStats *stats = _getOrAdd(opcode, subcode);
+    uint8_t index = OLED_TELEMETRY_NONE;
+    if (stats)
+    {
+        stats->commands++;
+        stats->bytesSent += bytes;
+        index = stats - _stats;
+    }
+
+    // Losing the oldest timing is better than losing the newest.
+    if (_inFlightCount >= OLED_TELEMETRY_IN_FLIGHT)
+    {
+        _inFlightHead = (_inFlightHead + 1) % OLED_TELEMETRY_IN_FLIGHT;
+        _inFlightCount--;
+    }
+    uint8_t slot = (_inFlightHead + _inFlightCount) % OLED_TELEMETRY_IN_FLIGHT;
+    _inFlightIndex[slot] = index;
+    _inFlightSentUs[slot] = micros();
+    _inFlightCount++;
+}
+
+// Takes the oldest command off the in-flight list and makes it the current response.
+uint32_t OLEDTelemetry::_popInFlight()
+{
+    if (_inFlightCount == 0)
+    {
+        _current = OLED_TELEMETRY_NONE;
+        return 0;
+    }
+    _current = _inFlightIndex[_inFlightHead];
+    uint32_t elapsed = micros() - _inFlightSentUs[_inFlightHead];
+    _inFlightHead = (_inFlightHead + 1) % OLED_TELEMETRY_IN_FLIGHT;
+    _inFlightCount--;
+    return elapsed;
+}
+
+void OLEDTelemetry::responseStarted()
+{
+    uint32_t elapsed = _popInFlight();
+    if (_current == OLED_TELEMETRY_NONE)
+        return;
+
+    uint8_t bucket = 0;
+    while (bucket < OLED_TELEMETRY_LATENCY_BUCKETS - 1 && elapsed >= getBucketLimitUs(bucket))
+        bucket++;
+    if (_stats[_current].latency[bucket] < 0xFFFF)
+        _stats[_current].latency[bucket]++;
+}
+
+void OLEDTelemetry::responseTimedOut()
+{
+    _popInFlight();
+    if (_current != OLED_TELEMETRY_NONE)
+        _stats[_current].timeouts++;
+    _current = OLED_TELEMETRY_NONE;
+}
+
+void OLEDTelemetry::byteReceived()
+{
+    if (_current != OLED_TELEMETRY_NONE)
+        _stats[_current].bytesReceived++;
+}
+
+void OLEDTelemetry::byteTimedOut()
+{
+    if (_current != OLED_TELEMETRY_NONE)
+        _stats[_current].timeouts++;
+}
+
+void OLEDTelemetry::acknowledged(bool ack)
+{
+    if (_current == OLED_TELEMETRY_NONE)
+        return;
+    if (ack)
+        _stats[_current].acks++;
+    else
+        _stats[_current].naks++;
+}
+
+void OLEDTelemetry::printReport(Print &out)
+{
+    for (uint8_t i = 0; i < _opcodeCount; i++)
+    {
+        OpcodeStats &stats = _stats[i];
+        out.print(OLEDUtil::byteToString(stats.opcode));
+        if (stats.opcode == OLED_CMD_EXTENDED_SD)
+        {
+            out.print(':');
+            out.print(OLEDUtil::byteToString(stats.subcode));
+        }
+        out.print(" n=");
+        out.print(stats.commands);
+        out.print(" tx=");
+        out.print(stats.bytesSent);
+        out.print(" rx=");
+        out.print(stats.bytesReceived);
+        out.print(" ack=");
+        out.print(stats.acks);
+        out.print(" nak=");
+        out.print(stats.naks);
+        out.print(" to=");
+        out.print(stats.timeouts);
+        out.print(" us");
+        for (uint8_t b = 0; b < OLED_TELEMETRY_LATENCY_BUCKETS; b++)
+        {
+            out.print(b == 0 ? '[' : ' ');
+            out.print(stats.latency[b]);
+        }
+        out.println(']');
+    }
+}
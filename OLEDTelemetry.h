@@ -0,0 +1,65 @@
+#ifndef OLEDTelemetry_h
+#define OLEDTelemetry_h
+
+#include <Arduino.h>
+
+#define OLED_TELEMETRY_MAX_OPCODES      16  // Distinct commands tracked; later ones are dropped
+#define OLED_TELEMETRY_IN_FLIGHT        16  // Commands whose response timing can be tracked at once
+#define OLED_TELEMETRY_LATENCY_BUCKETS  10  // Round-trip buckets: <128us, <256us, ... <32768us, more
+#define OLED_TELEMETRY_FIRST_BUCKET_US  128
+
+// Per-command counters for the transport, kept by OLED when OLED_TELEMETRY is enabled.
+// Commands are keyed by their OLED_CMD_* opcode, plus the sub-command for OLED_CMD_EXTENDED_SD.
+// Latency runs from when a command is handed to the transport to the first byte of its response.
+class OLEDTelemetry
+{
+public:
+    struct OpcodeStats
+    {
+        uint8_t opcode;
+        uint8_t subcode;
+        uint32_t commands;
+        uint32_t bytesSent;
+        uint32_t bytesReceived;
+        uint16_t acks;
+        uint16_t naks;
+        uint16_t timeouts;
+        uint16_t latency[OLED_TELEMETRY_LATENCY_BUCKETS];
+    };
+
+    OLEDTelemetry();
+    void clear();
+
+    uint8_t getOpcodeCount();
+    const OpcodeStats *getStats(uint8_t index);
+    const OpcodeStats *findStats(uint8_t opcode, uint8_t subcode = 0);
+    static uint32_t getBucketLimitUs(uint8_t bucket);
+    // One line per command: opcode, counts, then the latency histogram.
+    void printReport(Print &out);
+
+    // Called by OLED
+    void commandSent(uint8_t opcode, uint8_t subcode, uint16_t bytes);
+    void responseStarted();
+    void responseTimedOut();
+    void byteReceived();
+    void byteTimedOut();
+    void acknowledged(bool ack);
+    void clearInFlight();
+
+private:
+    OpcodeStats *_getOrAdd(uint8_t opcode, uint8_t subcode);
+    uint32_t _popInFlight();
+
+    OpcodeStats _stats[OLED_TELEMETRY_MAX_OPCODES];
+    uint8_t _opcodeCount;
+
+    // Commands awaiting their first response byte, oldest first
+    uint8_t _inFlightIndex[OLED_TELEMETRY_IN_FLIGHT];
+    uint32_t _inFlightSentUs[OLED_TELEMETRY_IN_FLIGHT];
+    uint8_t _inFlightHead;
+    uint8_t _inFlightCount;
+    // Stats entry of the response currently being read
+    uint8_t _current;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "OLEDTextField.h"
+
+OLEDTextField::OLEDTextField(OLED &oled, uint8_t col, uint8_t row, uint8_t width,
+    uint8_t fontSize, Align align)
+    : _oled(oled), _col(col), _row(row), _width(width), _fontSize(fontSize), _align(align),
+    _color(0xFFFF), _known(false)
+{
+    _shown = new char[width];
+    _next = new char[width];
+}
+
+OLEDTextField::~OLEDTextField()
+{
+    delete[] _shown;
+    delete[] _next;
+}
+
+void OLEDTextField::setColor(uint16_t color)
+{
+    if (color != _color)
+        _known = false;
+    _color = color;
+}
+
+void OLEDTextField::setColor(Color color)
+{
+    setColor(color.to16BitRGB());
+}
+
+void OLEDTextField::invalidate()
+{
+    _known = false;
+}
+
+bool OLEDTextField::print(const char *text)
+{
+    return _print(text, 0xFFFF, false);
+}
+
+bool OLEDTextField::print(const char *text, uint16_t length)
+{
+    return _print(text, length, false);
+}
+
+bool OLEDTextField::print(const __FlashStringHelper *text)
+{
+    return _print((const char *)text, 0xFFFF, true);
+}
+
+bool OLEDTextField::print(const String &text)
+{
+    return _print(text.c_str(), text.length(), false);
+}
+
+bool OLEDTextField::clear()
+{
+    return _print("", 0, false);
+}
+
+bool OLEDTextField::printNumber(int32_t value, uint8_t decimals)
+{
+    // Filled from the end: sign, 10 digits, a point and the leading zeros of a fraction
+    char buffer[24];
+    uint8_t start = sizeof(buffer);
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : value;
+    decimals = min(decimals, (uint8_t)(sizeof(buffer) - 13));
+    for (uint8_t digit = 0; magnitude > 0 || digit <= decimals; digit++)
+    {
+        if (digit == decimals && decimals > 0)
+            buffer[--start] = '.';
+        buffer[--start] = '0' + magnitude % 10;
+        magnitude /= 10;
+    }
+    if (value < 0)
+        buffer[--start] = '-';
+    return _print(buffer + start, sizeof(buffer) - start, false);
+}
+
+bool OLEDTextField::_print(const char *text, uint16_t length, bool progmem)
+{
+    if (!_shown || !_next)
+        return false;
+
+    // Pad the text out to the field's width.
+    uint8_t count = 0;
+    while (count < _width && count < length &&
+        (progmem ? pgm_read_byte(text + count) : text[count]) != 0x00)
+        count++;
+    uint8_t offset = _align == AlignRight ? _width - count : 0;
+    for (uint8_t c = 0; c < _width; c++)
+        _next[c] = ' ';
+    for (uint8_t c = 0; c < count; c++)
+        _next[offset + c] = progmem ? pgm_read_byte(text + c) : text[c];
+
+    // One draw per run of changed characters
+    bool result = true;
+    uint8_t c = 0;
+    while (c < _width)
+    {
+        if (_known && _next[c] == _shown[c])
+        {
+            c++;
+            continue;
+        }
+        uint8_t start = c;
+        uint8_t end = ++c;
+        while (c < _width && c - end < OLED_TEXT_FIELD_MERGE_GAP)
+        {
+            if (!_known || _next[c] != _shown[c])
+                end = c + 1;
+            c++;
+        }
+        c = end;
+        if (_oled.drawTextN(_col + start, _row, _next + start, end - start, _color, _fontSize,
+            OLED_FONT_OPAQUE, OLED_FONT_NONPROPORTIONAL))
+        {
+            for (uint8_t s = start; s < end; s++)
+                _shown[s] = _next[s];
+        }
+        else
+            result = false;
+    }
+    // Whatever failed to draw still differs, and is retried with the next print.
+    if (result)
+        _known = true;
+    return result;
+}
@@ -0,0 +1,73 @@
+#ifndef OLEDTextField_h
+#define OLEDTextField_h
+
+#include <Arduino.h>
+
+#include "FourDuino.h"
+
+#define OLED_TEXT_FIELD_MERGE_GAP   7   // Unchanged characters resent rather than starting another draw
+
+//
+// Text field
+//
+// A run of character cells at a fixed place, in one font and color, that only redraws
+// the characters that changed. The field remembers what it last showed; a new value is
+// padded to the field's width with spaces and compared with it, and each run of changed
+// characters is sent as one opaque draw. Runs a few characters apart are joined, since
+// another command costs more than resending what's between them. Spaces erase whatever
+// was left over when the text gets shorter.
+//
+//   OLEDTextField speed(oled, 5, 2, 6, OLED_FONT_MEDIUM, OLEDTextField::AlignRight);
+//   speed.printNumber(rpm);           // "  1450" -> "  1452" sends one character
+//   temperature.printNumber(215, 1);  // "21.5"
+//
+// Opaque text is drawn on the display's background color (setBackground). The field
+// can't see the screen being cleared or the display resetting: call invalidate() after
+// either, and the next print redraws the whole field.
+//
+class OLEDTextField
+{
+public:
+    enum Align
+    {
+        AlignLeft,
+        AlignRight
+    };
+
+    // Position in character cells of fontSize; width in characters.
+    OLEDTextField(OLED &oled, uint8_t col, uint8_t row, uint8_t width,
+        uint8_t fontSize = OLED_FONT_SMALL, Align align = AlignLeft);
+    ~OLEDTextField();
+
+    // Takes effect with the next print, which redraws the whole field.
+    void setColor(uint16_t color);
+    void setColor(Color color);
+
+    // Text longer than the field is cut off at the field's width.
+    bool print(const char *text);
+    bool print(const char *text, uint16_t length);
+    bool print(const __FlashStringHelper *text);
+    bool print(const String &text);
+    // Shows value / 10^decimals, e.g. printNumber(-1234, 2) shows "-12.34"
+    bool printNumber(int32_t value, uint8_t decimals = 0);
+    // Blanks the field.
+    bool clear();
+    // Forgets what the field shows.
+    void invalidate();
+
+private:
+    bool _print(const char *text, uint16_t length, bool progmem);
+
+    OLED &_oled;
+    uint8_t _col;
+    uint8_t _row;
+    uint8_t _width;
+    uint8_t _fontSize;
+    Align _align;
+    uint16_t _color;
+    char *_shown;       // What the display has, valid only if _known
+    char *_next;
+    bool _known;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "PosixSerialContainer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+PosixSerialContainer::PosixSerialContainer(const char *devicePath)
+    : SerialContainer(), _devicePath(devicePath), _fd(-1), _ownsFd(true),
+    _overflow(false), _rxHead(0), _rxCount(0) {}
+
+PosixSerialContainer::PosixSerialContainer(int fd)
+    : SerialContainer(), _devicePath(0), _fd(fd), _ownsFd(false),
+    _overflow(false), _rxHead(0), _rxCount(0) {}
+
+PosixSerialContainer::~PosixSerialContainer()
+{
+    end();
+}
+
+void PosixSerialContainer::begin(uint32_t baudRate)
+{
+    // OLED calls begin() again for every baud change, so only open once.
+    if (_fd < 0 && _devicePath)
+        _fd = open(_devicePath, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_fd < 0)
+        return;
+
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    _configure(baudRate);
+}
+
+void PosixSerialContainer::end()
+{
+    if (_fd >= 0 && _ownsFd)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+    _rxHead = 0;
+    _rxCount = 0;
+}
+
+static speed_t _getSpeed(uint32_t baudRate)
+{
+    switch (baudRate)
+    {
+    case 110: return B110;
+    case 300: return B300;
+    case 600: return B600;
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+#ifdef B230400
+    case 230400: return B230400;
+#endif
+    default: return B0;
+    }
+}
+
+bool PosixSerialContainer::_configure(uint32_t baudRate)
+{
+    struct termios tio;
+    if (tcgetattr(_fd, &tio) != 0)
+        return false;
+
+    // Raw 8N1, no flow control, reads never wait.
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB);
+#ifdef CRTSCTS
+    tio.c_cflag &= ~CRTSCTS;
+#endif
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+
+    speed_t speed = _getSpeed(baudRate);
+    if (speed != B0)
+    {
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+    }
+
+    // Let the command that asked for the new rate finish going out at the old one.
+    return tcsetattr(_fd, TCSADRAIN, &tio) == 0;
+}
+
+// Pulls whatever the kernel has into the local buffer.
+void PosixSerialContainer::_fill()
+{
+    if (_fd < 0)
+        return;
+    while (_rxCount < POSIX_SERIAL_RX_BUFFER_SIZE)
+    {
+        uint16_t tail = (_rxHead + _rxCount) % POSIX_SERIAL_RX_BUFFER_SIZE;
+        uint16_t room = POSIX_SERIAL_RX_BUFFER_SIZE - _rxCount;
+        if (room > POSIX_SERIAL_RX_BUFFER_SIZE - tail)
+            room = POSIX_SERIAL_RX_BUFFER_SIZE - tail;
+        ssize_t got = ::read(_fd, _rxBuffer + tail, room);
+        if (got <= 0)
+            return;
+        _rxCount += got;
+    }
+    // Buffer is full; note it if the kernel still has more for us.
+    int pending = 0;
+    if (ioctl(_fd, FIONREAD, &pending) == 0 && pending > 0)
+        _overflow = true;
+}
+
+int PosixSerialContainer::available()
+{
+    if (_rxCount == 0)
+        _fill();
+    return _rxCount;
+}
+
+int PosixSerialContainer::peek()
+{
+    if (!available())
+        return -1;
+    return _rxBuffer[_rxHead];
+}
+
+int PosixSerialContainer::read()
+{
+    if (!available())
+        return -1;
+    uint8_t data = _rxBuffer[_rxHead];
+    _rxHead = (_rxHead + 1) % POSIX_SERIAL_RX_BUFFER_SIZE;
+    _rxCount--;
+    return data;
+}
+
+void PosixSerialContainer::flush()
+{
+    if (_fd >= 0)
+        tcdrain(_fd);
+}
+
+bool PosixSerialContainer::overflow()
+{
+    bool result = _overflow;
+    _overflow = false;
+    return result;
+}
+
+size_t PosixSerialContainer::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+size_t PosixSerialContainer::write(const uint8_t *buffer, size_t size)
+{
+    if (_fd < 0)
+        return 0;
+    size_t written = 0;
+    while (written < size)
+    {
+        ssize_t result = ::write(_fd, buffer + written, size - written);
+        if (result > 0)
+        {
+            written += result;
+            continue;
+        }
+        if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            break;
+        // Kernel buffer is full; wait for it to drain a bit.
+        struct pollfd pfd = { _fd, POLLOUT, 0 };
+        poll(&pfd, 1, 100);
+    }
+    return written;
+}
+
+int PosixSerialContainer::availableForWrite()
+{
+    if (_fd < 0)
+        return 0;
+    struct pollfd pfd = { _fd, POLLOUT, 0 };
+    // The kernel doesn't say how much room it has, only that there is some.
+    return poll(&pfd, 1, 0) > 0 ? POSIX_SERIAL_TX_ROOM : 0;
+}
+
+bool PosixSerialContainer::waitForData(uint32_t timeoutUs)
+{
+    if (available())
+        return true;
+    if (_fd < 0)
+        return false;
+    struct pollfd pfd = { _fd, POLLIN, 0 };
+    // Round up so short timeouts still get one real wait.
+    int timeoutMs = (timeoutUs + 999) / 1000;
+    if (poll(&pfd, 1, timeoutMs) <= 0)
+        return false;
+    return available() > 0;
+}
+
+bool PosixSerialContainer::supportsBaud(uint32_t baudRate) { return _getSpeed(baudRate) != B0; }
+
+int PosixSerialContainer::getFd() { return _fd; }
+bool PosixSerialContainer::isOpen() { return _fd >= 0; }
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef PosixSerialContainer_h
+#define PosixSerialContainer_h
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "SerialContainers.h"
+
+#define POSIX_SERIAL_RX_BUFFER_SIZE     4096
+#define POSIX_SERIAL_TX_ROOM            256     // Room availableForWrite() reports while the port is writable
+
+// SerialContainer over a tty or pty on a Linux/POSIX host.
+// The descriptor is non-blocking; incoming bytes are pulled into a large local buffer
+// in as few read() calls as possible, and waits use poll() instead of spinning.
+class PosixSerialContainer : public SerialContainer
+{
+public:
+    // Opens the device at begin(). Rates termios doesn't know leave the speed unchanged;
+    // supportsBaud() says no to them, so the display is never moved to one.
+    PosixSerialContainer(const char *devicePath);
+    // Uses an already open descriptor (e.g. one end of a pty pair). It is not closed by end().
+    PosixSerialContainer(int fd);
+    ~PosixSerialContainer();
+
+    void begin(uint32_t baudRate);
+    void end();
+    int available();
+    int peek();
+    int read();
+    void flush();
+    bool overflow();
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *buffer, size_t size);
+    int availableForWrite();
+    bool waitForData(uint32_t timeoutUs);
+    bool supportsBaud(uint32_t baudRate);
+
+    int getFd();
+    bool isOpen();
+
+private:
+    bool _configure(uint32_t baudRate);
+    void _fill();
+
+    const char *_devicePath;
+    int _fd;
+    bool _ownsFd;
+    bool _overflow;
+    uint8_t _rxBuffer[POSIX_SERIAL_RX_BUFFER_SIZE];
+    uint16_t _rxHead;
+    uint16_t _rxCount;
+};
+
+#endif
+
+#endif
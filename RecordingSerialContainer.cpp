@@ -0,0 +1,166 @@
+#include "RecordingSerialContainer.h"
+
+RecordingSerialContainer::RecordingSerialContainer(SerialContainer &inner, Print *sink)
+    : SerialContainer(), _inner(inner), _sink(sink), _recording(true)
+{
+    clearRecording();
+}
+
+void RecordingSerialContainer::begin(uint32_t baudRate)
+{
+    if (_recording)
+    {
+        // Replay has to switch at exactly this point, so this gets a chunk of its own.
+        commit();
+        _startChunk(OLED_RECORDING_BAUD);
+        for (uint8_t i = 0; i < 4; i++)
+            _chunk[_chunkLength++] = baudRate >> (i * 8);
+        commit();
+    }
+    _inner.begin(baudRate);
+}
+
+void RecordingSerialContainer::end() { commit(); _inner.end(); }
+int RecordingSerialContainer::available() { return _inner.available(); }
+int RecordingSerialContainer::peek() { return _inner.peek(); }
+void RecordingSerialContainer::flush() { _inner.flush(); }
+bool RecordingSerialContainer::overflow() { return _inner.overflow(); }
+int RecordingSerialContainer::availableForWrite() { return _inner.availableForWrite(); }
+bool RecordingSerialContainer::waitForData(uint32_t timeoutUs) { return _inner.waitForData(timeoutUs); }
+bool RecordingSerialContainer::supportsBaud(uint32_t baudRate) { return _inner.supportsBaud(baudRate); }
+bool RecordingSerialContainer::isFullDuplex() { return _inner.isFullDuplex(); }
+
+int RecordingSerialContainer::read()
+{
+    int data = _inner.read();
+    if (data >= 0)
+    {
+        uint8_t byte = data;
+        _record(OLED_RECORDING_RX, &byte, 1);
+    }
+    return data;
+}
+
+size_t RecordingSerialContainer::write(uint8_t data)
+{
+    _record(0, &data, 1);
+    return _inner.write(data);
+}
+
+size_t RecordingSerialContainer::write(const uint8_t *buffer, size_t size)
+{
+    for (size_t offset = 0; offset < size; offset += OLED_RECORDER_MAX_PAYLOAD)
+    {
+        size_t length = size - offset;
+        if (length > OLED_RECORDER_MAX_PAYLOAD)
+            length = OLED_RECORDER_MAX_PAYLOAD;
+        _record(0, buffer + offset, length);
+    }
+    return _inner.write(buffer, size);
+}
+
+void RecordingSerialContainer::setRecording(bool recording)
+{
+    if (!recording)
+        commit();
+    _recording = recording;
+}
+
+bool RecordingSerialContainer::isRecording() { return _recording; }
+bool RecordingSerialContainer::recordingOverflowed() { return _overflowed; }
+
+void RecordingSerialContainer::clearRecording()
+{
+    _chunkLength = 0;
+    _ringHead = 0;
+    _ringCount = 0;
+    _overflowed = false;
+}
+
+void RecordingSerialContainer::_startChunk(uint8_t header)
+{
+    uint32_t now = micros();
+    _chunk[0] = header;
+    for (uint8_t i = 0; i < 4; i++)
+        _chunk[1 + i] = now >> (i * 8);
+    _chunkLength = OLED_RECORDER_HEADER_SIZE;
+}
+
+// Adds bytes to the open chunk, starting a new one when the direction changes or it fills up.
+void RecordingSerialContainer::_record(uint8_t direction, const uint8_t *data, uint8_t length)
+{
+    if (!_recording)
+        return;
+
+    if (_chunkLength > 0 &&
+        ((_chunk[0] & OLED_RECORDING_RX) != direction ||
+        _chunkLength - OLED_RECORDER_HEADER_SIZE + length > OLED_RECORDER_MAX_PAYLOAD))
+        commit();
+    if (_chunkLength == 0)
+        _startChunk(direction);
+
+    memcpy(_chunk + _chunkLength, data, length);
+    _chunkLength += length;
+    _chunk[0] = direction | (_chunkLength - OLED_RECORDER_HEADER_SIZE);
+}
+
+void RecordingSerialContainer::commit()
+{
+    if (_chunkLength == 0)
+        return;
+    _store(_chunk, _chunkLength);
+    if (_sink)
+        _sink->write(_chunk, _chunkLength);
+    _chunkLength = 0;
+}
+
+uint8_t RecordingSerialContainer::_ringByte(uint16_t offset)
+{
+    return _ring[(_ringHead + offset) % OLED_RECORDER_BUFFER_SIZE];
+}
+
+void RecordingSerialContainer::_store(const uint8_t *data, uint8_t length)
+{
+    // Drop whole chunks from the front until the new one fits.
+    while (_ringCount + length > OLED_RECORDER_BUFFER_SIZE && _ringCount > 0)
+    {
+        uint8_t header = _ringByte(0);
+        uint8_t payload = header == OLED_RECORDING_BAUD
+            ? 4 : header & OLED_RECORDING_LENGTH_MASK;
+        uint16_t chunk = OLED_RECORDER_HEADER_SIZE + payload;
+        _ringHead = (_ringHead + chunk) % OLED_RECORDER_BUFFER_SIZE;
+        _ringCount -= chunk;
+        _overflowed = true;
+    }
+
+    for (uint8_t i = 0; i < length; i++)
+        _ring[(_ringHead + _ringCount + i) % OLED_RECORDER_BUFFER_SIZE] = data[i];
+    _ringCount += length;
+}
+
+void RecordingSerialContainer::writeHeader(Print &out)
+{
+    out.write((const uint8_t *)OLED_RECORDING_MAGIC, 4);
+    out.write((uint8_t)OLED_RECORDING_VERSION);
+}
+
+void RecordingSerialContainer::dump(Print &out)
+{
+    commit();
+    writeHeader(out);
+    for (uint16_t i = 0; i < _ringCount; i++)
+        out.write(_ringByte(i));
+}
+
+uint16_t RecordingSerialContainer::copyRecording(uint8_t *buffer, uint16_t size)
+{
+    commit();
+    uint16_t needed = 5 + _ringCount;
+    if (size < needed)
+        return needed;
+    memcpy(buffer, OLED_RECORDING_MAGIC, 4);
+    buffer[4] = OLED_RECORDING_VERSION;
+    for (uint16_t i = 0; i < _ringCount; i++)
+        buffer[5 + i] = _ringByte(i);
+    return needed;
+}
@@ -0,0 +1,79 @@
+#ifndef RecordingSerialContainer_h
+#define RecordingSerialContainer_h
+
+#include "SerialContainers.h"
+
+#define OLED_RECORDER_BUFFER_SIZE   256     // Ring buffer for finished chunks; oldest are dropped
+#define OLED_RECORDER_MAX_PAYLOAD   127     // Bytes per chunk
+#define OLED_RECORDER_HEADER_SIZE   5
+
+// Recording format, as produced by dump() and consumed by OLEDReplay:
+//   "4DRC" 0x01, then chunks of
+//   1 byte:  bit 7 set for bytes received from the display, clear for bytes sent;
+//            bits 0-6 are the payload length (1-127), or 0 for a baud change
+//   4 bytes: micros() when the chunk started, little-endian
+//   payload: the bytes, or the new baud rate (4 bytes, little-endian) for a baud change
+#define OLED_RECORDING_MAGIC        "4DRC"
+#define OLED_RECORDING_VERSION      0x01
+#define OLED_RECORDING_RX           0x80
+#define OLED_RECORDING_LENGTH_MASK  0x7F
+#define OLED_RECORDING_BAUD         0x00
+
+// Passes everything through to another SerialContainer and records the exact bytes
+// going each way, with timestamps. Finished chunks go into a ring buffer and, if given,
+// straight out to a sink (a second serial port, a file on a host...).
+class RecordingSerialContainer : public SerialContainer
+{
+public:
+    RecordingSerialContainer(SerialContainer &inner, Print *sink = 0);
+
+    void begin(uint32_t baudRate);
+    void end();
+    int available();
+    int peek();
+    int read();
+    void flush();
+    bool overflow();
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *buffer, size_t size);
+    int availableForWrite();
+    bool waitForData(uint32_t timeoutUs);
+    bool supportsBaud(uint32_t baudRate);
+    bool isFullDuplex();
+
+    void setRecording(bool recording);
+    bool isRecording();
+    // Closes the chunk being collected so it shows up in the buffer and the sink.
+    void commit();
+    void clearRecording();
+    // True if old chunks had to be dropped to make room.
+    bool recordingOverflowed();
+
+    // Writes the header and the buffered recording. Only needed without a sink;
+    // with one, call writeHeader(sink) before recording starts.
+    void dump(Print &out);
+    static void writeHeader(Print &out);
+    // Copies the header and buffered recording into memory, for OLEDReplay.
+    // Returns the bytes needed, which may be more than size.
+    uint16_t copyRecording(uint8_t *buffer, uint16_t size);
+
+private:
+    void _startChunk(uint8_t header);
+    void _record(uint8_t direction, const uint8_t *data, uint8_t length);
+    void _store(const uint8_t *data, uint8_t length);
+    uint8_t _ringByte(uint16_t offset);
+
+    SerialContainer &_inner;
+    Print *_sink;
+    bool _recording;
+    bool _overflowed;
+
+    uint8_t _chunk[OLED_RECORDER_HEADER_SIZE + OLED_RECORDER_MAX_PAYLOAD];
+    uint8_t _chunkLength;
+
+    uint8_t _ring[OLED_RECORDER_BUFFER_SIZE];
+    uint16_t _ringHead;
+    uint16_t _ringCount;
+};
+
+#endif
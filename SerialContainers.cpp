@@ -1,6 +1,22 @@
 #include "SerialContainers.h"
 
 SerialContainer::SerialContainer(){}
+SerialContainer::~SerialContainer(){}
+
+bool SerialContainer::waitForData(uint32_t timeoutUs)
+{
+    uint32_t start = micros();
+    do
+    {
+        if (available())
+            return true;
+    }
+    while (micros() - start < timeoutUs);
+    return false;
+}
+
+bool SerialContainer::supportsBaud(uint32_t) { return true; }
+bool SerialContainer::isFullDuplex() { return true; }
 
 
 
@@ -14,6 +30,9 @@ int HardwareSerialContainer::read() { return _serial.read(); }
 void HardwareSerialContainer::flush() { _serial.flush(); }
 bool HardwareSerialContainer::overflow() { return false; }
 size_t HardwareSerialContainer::write(uint8_t data) { return _serial.write(data); }
+size_t HardwareSerialContainer::write(const uint8_t *buffer, size_t size)
+    { return _serial.write(buffer, size); }
+int HardwareSerialContainer::availableForWrite() { return _serial.availableForWrite(); }
 
 SoftwareSerialContainer::SoftwareSerialContainer(SoftwareSerial &serial)
     : _serial(serial), SerialContainer() {}
@@ -24,4 +43,9 @@ int SoftwareSerialContainer::peek() { return _serial.peek(); }
 int SoftwareSerialContainer::read() { return _serial.read(); }
 void SoftwareSerialContainer::flush() { _serial.flush(); }
 bool SoftwareSerialContainer::overflow() { return _serial.overflow(); }
-size_t SoftwareSerialContainer::write(uint8_t data) { return _serial.write(data); }
\ No newline at end of file
+size_t SoftwareSerialContainer::write(uint8_t data) { return _serial.write(data); }
+size_t SoftwareSerialContainer::write(const uint8_t *buffer, size_t size)
+    { return _serial.write(buffer, size); }
+// SoftwareSerial has no TX buffer; every byte blocks for its own bit time.
+int SoftwareSerialContainer::availableForWrite() { return 1; }
+bool SoftwareSerialContainer::isFullDuplex() { return false; }
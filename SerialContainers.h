@@ -8,6 +8,7 @@ class SerialContainer
 {
 public:
     SerialContainer();
+    virtual ~SerialContainer();
     virtual void begin(uint32_t baudRate) = 0;
     virtual void end() = 0;
     virtual int available() = 0;
@@ -16,6 +17,16 @@ public:
     virtual void flush() = 0;
     virtual bool overflow() = 0;
     virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+    // Bytes that can be written without blocking
+    virtual int availableForWrite() = 0;
+    // Waits up to timeoutUs for a byte to arrive. Returns false if none did.
+    virtual bool waitForData(uint32_t timeoutUs);
+    // Whether begin() can actually set this rate
+    virtual bool supportsBaud(uint32_t baudRate);
+    // Whether bytes can arrive while others are being sent. SoftwareSerial can't: it sends
+    // with interrupts off, so whatever comes in meanwhile is garbled or lost.
+    virtual bool isFullDuplex();
 };
 
 class HardwareSerialContainer : public SerialContainer
@@ -31,6 +42,8 @@ public:
     void flush();
     bool overflow();
     size_t write(uint8_t data);
+    size_t write(const uint8_t *buffer, size_t size);
+    int availableForWrite();
 };
 
 class SoftwareSerialContainer : public SerialContainer
@@ -46,6 +59,9 @@ public:
     void flush();
     bool overflow();
     size_t write(uint8_t data);
+    size_t write(const uint8_t *buffer, size_t size);
+    int availableForWrite();
+    bool isFullDuplex();
 };
 
 #endif
\ No newline at end of file
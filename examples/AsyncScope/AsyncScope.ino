@@ -0,0 +1,74 @@
+/*
+  AsyncScope
+  Samples an analog pin at a steady rate while the display catches up on its own time.
+
+  In asynchronous mode, drawing calls return as soon as the command is queued.
+  oled.poll() sends a few queued bytes and checks for ACKs each time it's called,
+  so loop() never sits waiting on the display and no samples are missed.
+  poll() only fills the port's transmit buffer, so it takes a few microseconds.
+
+  Asynchronous mode needs a hardware serial port: ACKs come back while later
+  commands are still going out, and SoftwareSerial can't receive while it sends.
+
+  Circuit:
+  * Needs a board with a spare hardware serial port (Mega, Leonardo, Pro Micro).
+  * D8 -> OLED Reset
+  * Serial1 RX -> OLED TX, Serial1 TX -> 1kOhm resistor -> OLED RX
+  * OLED 5V/GND to arduino 5V/GND
+  * Anything interesting on A3.
+
+  This example code is in the public domain.
+*/
+
+#include "SoftwareSerial.h" // Must be included
+#include "FourDuino.h"
+#include "Colors.h"
+
+#define SAMPLE_INTERVAL_US  2000
+
+OLED oled = OLED(8, Serial1, 38400);
+
+uint16_t width;
+uint16_t height;
+uint16_t x = 0;
+uint16_t lastY = 0;
+uint32_t lastSample = 0;
+uint16_t failures = 0;
+
+// Called from poll() as each queued command finishes.
+void onComplete(uint16_t handle, bool success)
+{
+    if (!success)
+        failures++;
+}
+
+void setup()
+{
+    oled.init();
+    width = oled.getDeviceWidth();
+    height = oled.getDeviceHeight();
+
+    oled.setCompletionCallback(onComplete);
+    oled.setAsync(true);
+}
+
+void loop()
+{
+    // Keep the display moving along.
+    oled.poll();
+
+    if (micros() - lastSample < SAMPLE_INTERVAL_US)
+        return;
+    lastSample = micros();
+
+    uint16_t y = height - 1 - OLEDUtil::scaleAnalog(analogRead(A3), height - 1);
+
+    // Only queue a new segment when there's room, so sampling never waits.
+    if (oled.getQueuedCommands() < OLED_ASYNC_QUEUE_COMMANDS - 2)
+    {
+        oled.drawLine(x, 0, x, height - 1, COLOR_BLACK);
+        oled.drawLine(x, lastY, x, y, COLOR_LIME);
+        lastY = y;
+        x = (x + 1) % width;
+    }
+}
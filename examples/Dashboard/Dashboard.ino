@@ -0,0 +1,57 @@
+/*
+  Dashboard
+  A status screen that only sends what changed.
+
+  Every pass through loop() declares the whole screen to an OLEDDisplayList and
+  commits it. The list compares it with the last frame and sends just the
+  commands for the readings that moved: usually a couple of small erases and
+  text draws, instead of a full repaint. Over a slow link that's the difference
+  between a screen that flickers along and one that keeps up.
+
+  The serial monitor shows how many commands each frame took.
+
+  Circuit:
+  * Same as the other examples: D8 -> OLED Reset, D10 -> OLED TX,
+    D9 -> 1kOhm resistor -> OLED RX, OLED 5V/GND to arduino 5V/GND
+  * Something to read on A0 and A1.
+
+  This example code is in the public domain.
+*/
+
+#include "SoftwareSerial.h" // Must be included
+#include "FourDuino.h"
+#include "OLEDDisplayList.h"
+#include "Colors.h"
+
+OLED oled = OLED(8, SoftwareSerial(10,9), 9600);
+OLEDDisplayList screen(oled);
+
+uint16_t width;
+
+void setup()
+{
+    Serial.begin(115200);
+    oled.init();
+    width = oled.getDeviceWidth();
+}
+
+void loop()
+{
+    uint16_t a0 = analogRead(A0);
+    uint16_t a1 = analogRead(A1);
+
+    // Static parts cost nothing after the first frame.
+    screen.drawRectangle(1, 0, 0, width - 1, 9, COLOR_NAVY, true);
+    screen.drawText(2, 2, 1, "Dashboard", COLOR_WHITE);
+    screen.drawText(3, 2, 16, "A0: " + String(a0), COLOR_WHITE);
+    screen.drawText(4, 2, 26, "A1: " + String(a1), COLOR_WHITE);
+    // A bar that only grows or shrinks when the reading does
+    screen.drawRectangle(5, 2, 40, 2 + (uint32_t)(width - 5) * a0 / 1023, 47, COLOR_LIME, true);
+    // Warning light that comes and goes
+    if (a1 > 512)
+        screen.drawCircle(6, width - 8, 28, 4, COLOR_RED, true);
+
+    screen.commit();
+    Serial.println(screen.getLastCommandCount());
+    delay(250);
+}
@@ -0,0 +1,66 @@
+/*
+  DoubleBuffer
+  A ball bouncing around a box without flicker.
+
+  Erasing the ball and drawing it again in its new place shows, for a moment, a
+  box with no ball in it. Here the top half of the screen is what's shown, and
+  the bottom half is a back buffer: each frame is drawn down there, then copied
+  up in one go with screenCopyPaste, covering just the area that changed.
+
+  Meant for a panel where the bottom half can be hidden (or a bigger one where
+  only the top part is used); on the smaller displays you'll see the back buffer
+  being drawn, but the top half still doesn't flicker.
+
+  Circuit:
+  * Same as the other examples: D8 -> OLED Reset, D10 -> OLED TX,
+    D9 -> 1kOhm resistor -> OLED RX, OLED 5V/GND to arduino 5V/GND
+
+  This example code is in the public domain.
+*/
+
+#include "SoftwareSerial.h" // Must be included
+#include "FourDuino.h"
+#include "Colors.h"
+
+#define RADIUS  6
+
+OLED oled = OLED(8, SoftwareSerial(10,9), 38400);
+
+uint16_t width;
+uint16_t height;
+int16_t x = 20, y = 20;
+int16_t dx = 3, dy = 2;
+
+void setup()
+{
+    oled.init();
+    width = oled.getDeviceWidth();
+    // Half the screen, in whole character cells so text lands in the same place
+    height = oled.getDeviceHeight() / 2 / 8 * 8;
+    oled.setBackBuffer(0, 0, width, height, 0, height);
+    oled.setFill(true);
+
+    // The first frame draws everything.
+    oled.beginFrame();
+    oled.drawRectangle(0, 0, width - 1, height - 1, COLOR_NAVY);
+    oled.drawText(0, 0, "Bounce", COLOR_WHITE);
+    oled.endFrame();
+}
+
+void loop()
+{
+    int16_t lastX = x, lastY = y;
+    if (x + dx < RADIUS || x + dx >= width - RADIUS)
+        dx = -dx;
+    if (y + dy < RADIUS + 8 || y + dy >= height - RADIUS)
+        dy = -dy;
+    x += dx;
+    y += dy;
+
+    // Only the old and new ball are drawn, so only they are copied.
+    oled.beginFrame();
+    oled.drawRectangle(lastX - RADIUS, lastY - RADIUS, lastX + RADIUS, lastY + RADIUS, COLOR_NAVY);
+    oled.drawCircle(x, y, RADIUS, COLOR_ORANGE);
+    oled.endFrame();
+    delay(20);
+}
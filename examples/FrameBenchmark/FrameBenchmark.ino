@@ -0,0 +1,133 @@
+/*
+  FrameBenchmark
+  Measures what collecting command bytes into frames saves on real drawing calls.
+
+  Every OLED command used to go out one virtual write() per byte. Commands are
+  now collected into a small frame (OLED_FRAME_BUFFER_SIZE bytes) and sent with
+  a single bulk write. This sketch runs the same drawLine and drawText calls
+  through OLED twice: once as the library sends them, and once through a
+  container that splits every frame back into one write() per byte, the way
+  they used to go out.
+
+  For each it prints the time per call spent inside write() and the bytes per
+  second handed to the port there, which is what framing changes, then the
+  whole time per call and bytes per second, which also include waiting for
+  the display's ACK.
+
+  Circuit:
+  * Needs a board with a spare hardware serial port (Mega, Leonardo, Pro Micro).
+  * D8 -> OLED Reset
+  * Serial1 RX -> OLED TX, Serial1 TX -> 1kOhm resistor -> OLED RX
+  * OLED 5V/GND to arduino 5V/GND
+  * Results are printed to Serial at 115200.
+
+  This example code is in the public domain.
+*/
+
+#include "SoftwareSerial.h" // Must be included
+#include "FourDuino.h"
+
+#define BENCH_BAUD          115200
+#define BENCH_CALLS         200
+
+// Serial1, timing every write(). Unframed, each frame is written a byte at a time.
+class TimedContainer : public HardwareSerialContainer
+{
+public:
+    TimedContainer(HardwareSerial &serial)
+        : HardwareSerialContainer(serial), framed(true), writeUs(0), writeBytes(0) {}
+
+    size_t write(uint8_t data)
+    {
+        uint32_t start = micros();
+        size_t result = HardwareSerialContainer::write(data);
+        writeUs += micros() - start;
+        writeBytes += result;
+        return result;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        uint32_t start = micros();
+        size_t result = 0;
+        if (framed)
+            result = HardwareSerialContainer::write(buffer, size);
+        else
+        {
+            for (size_t i = 0; i < size; i++)
+                result += HardwareSerialContainer::write(buffer[i]);
+        }
+        writeUs += micros() - start;
+        writeBytes += result;
+        return result;
+    }
+
+    bool framed;
+    uint32_t writeUs;
+    uint32_t writeBytes;
+};
+
+TimedContainer container(Serial1);
+OLED oled(8, &container, BENCH_BAUD);
+
+float bytesPerSecond(uint32_t bytes, uint32_t elapsedUs)
+{
+    return elapsedUs > 0 ? (float)bytes * 1000000 / elapsedUs : 0;
+}
+
+void report(const char *label, uint32_t totalUs)
+{
+    Serial.print(label);
+    Serial.print(": ");
+    Serial.print(container.writeUs / BENCH_CALLS);
+    Serial.print("us in write() (");
+    Serial.print(bytesPerSecond(container.writeBytes, container.writeUs), 0);
+    Serial.print(" bytes/sec), ");
+    Serial.print(totalUs / BENCH_CALLS);
+    Serial.print("us per call (");
+    Serial.print(bytesPerSecond(container.writeBytes, totalUs), 0);
+    Serial.println(" bytes/sec)");
+}
+
+void benchLines(const char *label)
+{
+    container.writeUs = 0;
+    container.writeBytes = 0;
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < BENCH_CALLS; i++)
+        oled.drawLine(i % 96, 0, 95 - i % 96, 63, (uint16_t)(i * 0x0821));
+    report(label, micros() - start);
+}
+
+void benchText(const char *label)
+{
+    container.writeUs = 0;
+    container.writeBytes = 0;
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < BENCH_CALLS; i++)
+        oled.drawText(0, i % 8, "Frame benchmark", (uint16_t)(i * 0x0821));
+    report(label, micros() - start);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    oled.init();
+}
+
+void loop()
+{
+    oled.clear();
+    container.framed = false;
+    benchLines("drawLine per-byte");
+    container.framed = true;
+    benchLines("drawLine framed  ");
+
+    oled.clear();
+    container.framed = false;
+    benchText("drawText per-byte");
+    container.framed = true;
+    benchText("drawText framed  ");
+    Serial.println();
+    delay(2000);
+}
@@ -0,0 +1,88 @@
+/*
+  Heatmap
+  Plots a heatmap and a scatter plot pixel by pixel, with and without batching.
+
+  Each drawPixel is a command of its own, with its own ACK to wait for. Between
+  beginPixels() and endPixels() the pixels are collected instead, and sent as
+  lines and rectangles along runs of one color, or as a single image where the
+  batch is dense enough. Heatmap cells come out as a rectangle each; scattered
+  points still go one at a time, but nothing is lost by batching them.
+
+  The serial monitor shows how long each pass took.
+
+  Circuit:
+  * Same as the other examples: D8 -> OLED Reset, D10 -> OLED TX,
+    D9 -> 1kOhm resistor -> OLED RX, OLED 5V/GND to arduino 5V/GND
+  * Something to read on A0 and A1.
+
+  This example code is in the public domain.
+*/
+
+#include "SoftwareSerial.h" // Must be included
+#include "FourDuino.h"
+#include "Colors.h"
+
+#define CELL_SIZE   4   // Heatmap cell, in pixels
+#define CELLS       8   // Cells along each side of the heatmap
+#define POINTS      64  // Points in the scatter plot
+
+OLED oled = OLED(8, SoftwareSerial(10,9), 9600);
+
+uint16_t heatColor(uint16_t reading)
+{
+    // Blue through to red
+    uint8_t level = reading >> 5;
+    return Color::to16BitRGB(level << 3, 0, 255 - (level << 3));
+}
+
+void plot()
+{
+    // Heatmap in the top left: every pixel of a cell is the same color.
+    for (uint8_t row = 0; row < CELLS; row++)
+    {
+        for (uint8_t col = 0; col < CELLS; col++)
+        {
+            uint16_t color = heatColor((analogRead(A0) + row * 64 + col * 64) & 0x3FF);
+            for (uint8_t y = 0; y < CELL_SIZE; y++)
+                for (uint8_t x = 0; x < CELL_SIZE; x++)
+                    oled.drawPixel(col * CELL_SIZE + x, row * CELL_SIZE + y, color);
+        }
+    }
+
+    // Scatter plot underneath
+    uint16_t top = CELLS * CELL_SIZE + 4;
+    uint16_t height = oled.getDeviceHeight() - top;
+    for (uint8_t i = 0; i < POINTS; i++)
+    {
+        uint16_t x = (uint32_t)analogRead(A0) * (oled.getDeviceWidth() - 1) / 1023;
+        uint16_t y = top + (uint32_t)analogRead(A1) * (height - 1) / 1023;
+        oled.drawPixel(x, y, COLOR_YELLOW);
+    }
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    oled.init();
+}
+
+void loop()
+{
+    oled.clear();
+    uint32_t start = millis();
+    plot();
+    Serial.print("pixel by pixel: ");
+    Serial.print(millis() - start);
+    Serial.println("ms");
+
+    oled.clear();
+    start = millis();
+    oled.beginPixels();
+    plot();
+    oled.endPixels();
+    Serial.print("batched:        ");
+    Serial.print(millis() - start);
+    Serial.println("ms");
+
+    delay(2000);
+}
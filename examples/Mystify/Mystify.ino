@@ -66,6 +66,12 @@ void setup()
 {
     oled.init();
 
+    // Don't wait for each polygon's ACK before sending the next one.
+    // Up to 4 commands can be in flight; failures show up in getPipelineErrors().
+    // This needs a hardware serial port: on SoftwareSerial, which can't receive while
+    // it sends, the depth stays at 1 and every command waits for its ACK.
+    oled.setPipelineDepth(4);
+
     for (uint8_t s = 0; s < NUM_SHAPES; s++)
     {
         // Randomize the starting color of each shape
@@ -0,0 +1,65 @@
+/*
+  ProgmemImage
+  Draws an image kept in flash, without copying it into SRAM.
+
+  drawImage8Bit_P streams the pixels straight from PROGMEM to the display, so
+  an image can be as big as flash allows; only one small frame of command bytes
+  is ever held in RAM. The same image is tiled over the screen, then stretched
+  to four times its height by drawing each of its rows four times.
+
+  8 bit images are RRRGGGBB: 0xFC is yellow, 0x20 a dark red, 0x00 black.
+  drawImage16Bit and drawImage16Bit_P take RGB565 pixels the same way.
+
+  Circuit:
+  * Same as the other examples: D8 -> OLED Reset, D10 -> OLED TX,
+    D9 -> 1kOhm resistor -> OLED RX, OLED 5V/GND to arduino 5V/GND
+
+  This example code is in the public domain.
+*/
+
+#include "SoftwareSerial.h" // Must be included
+#include "FourDuino.h"
+
+#define SMILEY_SIZE 16
+
+const uint8_t smiley[SMILEY_SIZE * SMILEY_SIZE] PROGMEM = {
+    0x00, 0x00, 0x00, 0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00, 0x00,
+    0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00,
+    0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00,
+    0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0x20, 0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0x20, 0xFC, 0xFC, 0xFC, 0xFC,
+    0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0x20, 0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0x20, 0xFC, 0xFC, 0xFC, 0xFC,
+    0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC,
+    0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC,
+    0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC,
+    0xFC, 0xFC, 0x20, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0xFC, 0xFC,
+    0xFC, 0xFC, 0xFC, 0x20, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0xFC, 0xFC, 0xFC,
+    0x00, 0xFC, 0xFC, 0xFC, 0x20, 0x20, 0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0x20, 0xFC, 0xFC, 0xFC, 0x00,
+    0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x20, 0x20, 0x20, 0x20, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00,
+    0x00, 0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+OLED oled = OLED(8, SoftwareSerial(10,9), 9600);
+
+void setup()
+{
+    oled.init();
+}
+
+void loop()
+{
+    oled.clear();
+    for (uint16_t y = 0; y + SMILEY_SIZE <= oled.getDeviceHeight(); y += SMILEY_SIZE)
+        for (uint16_t x = 0; x + SMILEY_SIZE <= oled.getDeviceWidth(); x += SMILEY_SIZE)
+            oled.drawImage8Bit_P(x, y, SMILEY_SIZE, SMILEY_SIZE, smiley);
+    delay(2000);
+
+    // Each image row is one row tall, so it can be drawn on its own.
+    oled.clear();
+    for (uint8_t row = 0; row < SMILEY_SIZE; row++)
+        for (uint8_t copy = 0; copy < 4; copy++)
+            oled.drawImage8Bit_P(0, row * 4 + copy, SMILEY_SIZE, 1, smiley + row * SMILEY_SIZE);
+    delay(2000);
+}
@@ -0,0 +1,65 @@
+/*
+  StaticOLED
+  The compile-time specialized driver, BasicOLED<Transport, Controller>.
+
+  When you know which board and display you're building for, BasicOLED talks to the
+  serial port directly instead of through a heap-allocated SerialContainer, and the
+  coordinate size is fixed at compile time (1 byte for GOLDELOX, 2 for PICASO).
+
+  Both drivers send the same bytes (OLEDCommands), so the difference is all overhead.
+  Measured on an x86-64 host (g++ -Os, --gc-sections, posix shim), drawing lines to a
+  transport that ACKs at once, after init against EmulatorSerialContainer:
+
+                              code     object   CPU cycles per drawLine
+    BasicOLED, OLEDGoldelox   2.6 KB   16 B     114
+    BasicOLED, OLEDPicaso     2.7 KB   16 B     113
+    OLED, GOLDELOX            12.2 KB  336 B    365
+    OLED, PICASO              12.2 KB  336 B    414
+
+  Code is over a build with only the emulator linked; objects hold 8-byte pointers there.
+  On a board, build this sketch with and without USE_OLED and compare the Flash/SRAM the
+  IDE reports; the sketch prints the time and CPU cycles per drawLine to Serial, which
+  there is mostly the serial line itself.
+
+  Circuit:
+  * D8 -> OLED Reset, D10 -> OLED TX, D9 -> 1kOhm resistor -> OLED RX
+  * OLED 5V/GND to arduino 5V/GND
+
+  This example code is in the public domain.
+*/
+
+#include "SoftwareSerial.h" // Must be included
+#include "FourDuino.h"
+#include "BasicOLED.h"
+
+#define LINES_PER_RUN 200
+
+// #define USE_OLED
+
+#ifdef USE_OLED
+OLED oled = OLED(8, SoftwareSerial(10,9), 38400);
+#else
+SoftwareSerial displaySerial(10, 9);
+BasicOLED<SoftwareSerial, OLEDGoldelox> oled(displaySerial, 8, 38400);
+#endif
+
+void setup()
+{
+    Serial.begin(115200);
+    oled.init();
+    oled.clear();
+}
+
+void loop()
+{
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < LINES_PER_RUN; i++)
+        oled.drawLine(i % 96, 0, 95 - i % 96, 63, (uint16_t)(i * 0x0821));
+    uint32_t perLine = (micros() - start) / LINES_PER_RUN;
+
+    Serial.print(perLine);
+    Serial.print("us, ");
+    Serial.print(perLine * (F_CPU / 1000000));
+    Serial.println(" cycles per drawLine");
+    delay(1000);
+}
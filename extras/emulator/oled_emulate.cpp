@@ -0,0 +1,200 @@
+// Drives the whole OLED API against EmulatorSerialContainer: no display needed.
+// Times a mix of commands with and without pipelining, checks the results (and a shadow
+// framebuffer) against the emulated framebuffer and SD image, compares ways of sending big
+// polygons, and saves the screen.
+// Build from the library root:
+//
+//   g++ -std=gnu++11 -Iextras/posix -I. *.cpp extras/posix/*.cpp extras/emulator/oled_emulate.cpp -o oled_emulate
+//   ./oled_emulate [width height [sd.img [screen.ppm]]]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FourDuino.h"
+#include "EmulatorSerialContainer.h"
+
+#define RESET_PIN   8
+
+static EmulatorSerialContainer *emulator;
+
+static void onPinWrite(uint8_t pin, uint8_t value)
+{
+    if (pin == RESET_PIN && value == LOW)
+        emulator->reset();
+}
+
+#define STAR_POINTS 24
+
+// Commands sent for each of: a filled star by ear clipping and as a naive triangle fan,
+// and its outline as chains and as separate lines. The fan also fills the star's notches.
+static void benchmarkPolygons(OLED &oled, EmulatorSerialContainer &display)
+{
+    uint16_t w = oled.getDeviceWidth();
+    uint16_t h = oled.getDeviceHeight();
+    uint16_t star[STAR_POINTS][2];
+    for (uint8_t i = 0; i < STAR_POINTS; i++)
+    {
+        float angle = i * 2 * M_PI / STAR_POINTS;
+        float radius = (i % 2 ? 0.15f : 0.45f) * min(w, h);
+        star[i][0] = w / 2 + radius * cos(angle);
+        star[i][1] = h / 2 + radius * sin(angle);
+    }
+    uint16_t white = Color::from32BitRGB(0xFFFFFF).to16BitRGB();
+
+    oled.clear();
+    uint32_t before = display.getStats().commands;
+    oled.fillPolygon(white, STAR_POINTS, star);
+    uint32_t earCommands = display.getStats().commands - before;
+    uint32_t earPixels = 0;
+    for (uint16_t y = 0; y < h; y++)
+        for (uint16_t x = 0; x < w; x++)
+            earPixels += display.getPixel(x, y) == white;
+
+    oled.clear();
+    oled.setFill(true);
+    before = display.getStats().commands;
+    for (uint8_t i = 1; i + 1 < STAR_POINTS; i++)
+        oled.drawTriangle(star[0][0], star[0][1], star[i][0], star[i][1],
+            star[i + 1][0], star[i + 1][1], white);
+    uint32_t fanCommands = display.getStats().commands - before;
+    uint32_t fanPixels = 0;
+    for (uint16_t y = 0; y < h; y++)
+        for (uint16_t x = 0; x < w; x++)
+            fanPixels += display.getPixel(x, y) == white;
+
+    oled.clear();
+    before = display.getStats().commands;
+    oled.drawPolygon(white, STAR_POINTS, star);
+    uint32_t chainCommands = display.getStats().commands - before;
+    before = display.getStats().commands;
+    for (uint8_t i = 0; i < STAR_POINTS; i++)
+        oled.drawLine(star[i][0], star[i][1],
+            star[(i + 1) % STAR_POINTS][0], star[(i + 1) % STAR_POINTS][1], white);
+    uint32_t lineCommands = display.getStats().commands - before;
+
+    printf("polygons: filled %u-gon %lu commands (%lu pixels), fan %lu commands (%lu pixels); "
+        "outline %lu commands, as lines %lu\n", STAR_POINTS,
+        (unsigned long)earCommands, (unsigned long)earPixels,
+        (unsigned long)fanCommands, (unsigned long)fanPixels,
+        (unsigned long)chainCommands, (unsigned long)lineCommands);
+}
+
+static uint32_t drawScene(OLED &oled)
+{
+    uint32_t start = micros();
+    uint16_t w = oled.getDeviceWidth();
+    uint16_t h = oled.getDeviceHeight();
+    oled.clear();
+    for (uint16_t i = 0; i < 32; i++)
+        oled.drawLine(0, i * h / 32, w - 1, h - 1 - i * h / 32, Color::from32BitRGB(0x00FF00 + i * 8));
+    oled.drawRectangleWH(4, 4, w / 4, h / 4, Color::from32BitRGB(0xFF0000));
+    oled.drawCircle(w / 2, h / 2, h / 6, Color::from32BitRGB(0x0000FF));
+    oled.drawTriangle(w - 20, 4, w - 4, 20, w - 36, 20, Color::from32BitRGB(0xFFFF00));
+    oled.drawTextGraphic(4, h - 10, "FourDuino");
+    oled.drainPipeline();
+    return micros() - start;
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t width = argc > 2 ? atoi(argv[1]) : 128;
+    uint16_t height = argc > 2 ? atoi(argv[2]) : 128;
+    const char *sdPath = argc > 3 ? argv[3] : 0;
+    const char *ppmPath = argc > 4 ? argv[4] : "screen.ppm";
+
+    EmulatorSerialContainer display(width, height, sdPath);
+    emulator = &display;
+    setPinWriteHook(onPinWrite);
+
+    OLED oled(RESET_PIN, &display, 115200);
+    if (!oled.init())
+    {
+        printf("init failed\n");
+        return 1;
+    }
+    printf("%ux%u %s at %lu baud\n", oled.getDeviceWidth(), oled.getDeviceHeight(),
+        oled.getControllerType() == OLED::Picaso ? "Picaso" : "Goldelox",
+        (unsigned long)oled.getBaud());
+
+    uint32_t syncUs = drawScene(oled);
+    oled.setPipelineDepth(4);
+    uint32_t pipelinedUs = drawScene(oled);
+    oled.setPipelineDepth(1);
+    printf("scene: %lu us synchronous, %lu us pipelined\n",
+        (unsigned long)syncUs, (unsigned long)pipelinedUs);
+
+    bool ok = true;
+    uint16_t pixel;
+    if (!oled.readPixel(4, 4, pixel) || pixel != display.getPixel(4, 4) || pixel != 0xF800)
+    {
+        printf("readPixel mismatch\n");
+        ok = false;
+    }
+
+    // Mirror a scene into a shadow: everything it claims to know must match the display,
+    // and reads of it must not touch the wire.
+    OLEDShadow shadow(oled.getDeviceWidth(), oled.getDeviceHeight());
+    oled.setShadow(&shadow);
+    drawScene(oled);
+    oled.setFill(true);
+    oled.drawRectangle(8, 8, 40, 40, Color::from32BitRGB(0x00FFFF));
+    oled.screenCopyPaste(8, 8, 60, 60, 33, 33);
+    oled.drawPolygon(Color::from32BitRGB(0xFF00FF), 5, 10, 50, 30, 45, 40, 70, 20, 90, 5, 70);
+    oled.replaceBackground(Color::from32BitRGB(0x202020));
+    uint32_t known = 0, differing = 0;
+    for (uint16_t y = 0; y < oled.getDeviceHeight(); y++)
+    {
+        for (uint16_t x = 0; x < oled.getDeviceWidth(); x++)
+        {
+            if (!shadow.getPixel(x, y, pixel))
+                continue;
+            known++;
+            if (pixel != display.getPixel(x, y))
+                differing++;
+        }
+    }
+    uint32_t commandsBefore = display.getStats().commands;
+    uint32_t start = micros();
+    for (uint16_t x = 0; x < oled.getDeviceWidth(); x++)
+        oled.readPixel(x, 20, pixel);
+    printf("shadow: %lu pixels known, %lu differ; %u reads took %lu us and %lu commands\n",
+        (unsigned long)known, (unsigned long)differing, oled.getDeviceWidth(),
+        (unsigned long)(micros() - start),
+        (unsigned long)(display.getStats().commands - commandsBefore));
+    if (differing > 0 || !oled.verifyShadow(64))
+    {
+        printf("shadow mismatch\n");
+        ok = false;
+    }
+    oled.setShadow(0);
+
+    benchmarkPolygons(oled, display);
+
+    if (sdPath)
+    {
+        uint8_t sector[OLED_SD_SECTOR_SIZE], readBack[OLED_SD_SECTOR_SIZE];
+        for (uint16_t b = 0; b < OLED_SD_SECTOR_SIZE; b++)
+            sector[b] = b * 7;
+        uint32_t start = micros();
+        if (!oled.SDInitialize() ||
+            !oled.SDWriteSector(1, sector) ||
+            !oled.SDReadSector(1, readBack) ||
+            memcmp(sector, readBack, sizeof(sector)) != 0)
+        {
+            printf("SD sector round trip failed\n");
+            ok = false;
+        }
+        printf("SD sector round trip: %lu us\n", (unsigned long)(micros() - start));
+    }
+
+    const EmulatorSerialContainer::Stats &stats = display.getStats();
+    printf("commands=%lu naks=%lu rx=%lu tx=%lu pixels=%lu garbled=%lu\n",
+        (unsigned long)stats.commands, (unsigned long)stats.naks,
+        (unsigned long)stats.bytesReceived, (unsigned long)stats.bytesSent,
+        (unsigned long)stats.pixelsDrawn, (unsigned long)stats.garbledBytes);
+
+    if (!display.savePPM(ppmPath))
+        ok = false;
+    return ok ? 0 : 1;
+}
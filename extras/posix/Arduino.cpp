@@ -0,0 +1,117 @@
+#include "Arduino.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+static struct timespec _startTime;
+static bool _started = false;
+
+static uint64_t _elapsedUs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!_started)
+    {
+        _startTime = now;
+        _started = true;
+    }
+    return (uint64_t)(now.tv_sec - _startTime.tv_sec) * 1000000 +
+        (now.tv_nsec - _startTime.tv_nsec) / 1000;
+}
+
+unsigned long millis() { return (unsigned long)(_elapsedUs() / 1000); }
+unsigned long micros() { return (unsigned long)_elapsedUs(); }
+
+static void _sleepUs(uint64_t us)
+{
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+void delay(unsigned long ms) { _sleepUs((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { _sleepUs(us); }
+
+
+static PinWriteHook _pinWriteHook = 0;
+
+void setPinWriteHook(PinWriteHook hook) { _pinWriteHook = hook; }
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (_pinWriteHook)
+        _pinWriteHook(pin, value);
+}
+int digitalRead(uint8_t pin) { return LOW; }
+int analogRead(uint8_t pin) { return 0; }
+
+
+void randomSeed(unsigned long seed) { srandom(seed); }
+
+long random(long howBig)
+{
+    if (howBig <= 0)
+        return 0;
+    return ::random() % howBig;
+}
+
+long random(long howSmall, long howBig)
+{
+    if (howSmall >= howBig)
+        return howSmall;
+    return random(howBig - howSmall) + howSmall;
+}
+
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer)
+{
+    sprintf(buffer, "%*.*f", width, precision, value);
+    return buffer;
+}
+
+
+String::String(double value, unsigned char decimalPlaces)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, value);
+    _s = buffer;
+}
+
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (size--)
+        written += write(*buffer++);
+    return written;
+}
+
+
+HardwareSerial Serial;
+
+int HardwareSerial::available()
+{
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    return poll(&pfd, 1, 0) > 0 ? 1 : 0;
+}
+
+int HardwareSerial::peek()
+{
+    int c = getchar();
+    if (c != EOF)
+        ungetc(c, stdin);
+    return c == EOF ? -1 : c;
+}
+
+int HardwareSerial::read()
+{
+    int c = getchar();
+    return c == EOF ? -1 : c;
+}
+
+void HardwareSerial::flush() { fflush(stdout); }
+size_t HardwareSerial::write(uint8_t data) { return fwrite(&data, 1, 1, stdout); }
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
@@ -0,0 +1,169 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Just enough of the Arduino core for the library to build on a Linux/POSIX host.
+// Put this directory ahead of the library on the include path:
+//   g++ -Iextras/posix -I. *.cpp extras/posix/*.cpp your_program.cpp
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <type_traits>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH            0x1
+#define LOW             0x0
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+// No separate program memory on a host; flash strings are ordinary strings.
+#define PROGMEM
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+// By value: with two arguments of one type, the conditional is a reference to a parameter.
+template<class A, class B> inline typename std::common_type<A, B>::type min(A a, B b)
+    { return a < b ? a : b; }
+template<class A, class B> inline typename std::common_type<A, B>::type max(A a, B b)
+    { return a > b ? a : b; }
+template<class T, class L, class H> inline T constrain(T x, L low, H high)
+    { return x < low ? low : (x > high ? high : x); }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Pins don't exist on the host. Reset requests can be observed through a hook if needed.
+typedef void (*PinWriteHook)(uint8_t pin, uint8_t value);
+void setPinWriteHook(PinWriteHook hook);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+void randomSeed(unsigned long seed);
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer);
+
+class String
+{
+public:
+    String(const char *cstr = "") : _s(cstr ? cstr : "") {}
+    String(const std::string &s) : _s(s) {}
+    String(const __FlashStringHelper *fstr) : _s(reinterpret_cast<const char *>(fstr)) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int value) : _s(std::to_string(value)) {}
+    explicit String(unsigned int value) : _s(std::to_string(value)) {}
+    explicit String(long value) : _s(std::to_string(value)) {}
+    explicit String(unsigned long value) : _s(std::to_string(value)) {}
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    unsigned int length() const { return _s.length(); }
+    const char *c_str() const { return _s.c_str(); }
+    void toCharArray(char *buffer, unsigned int size, unsigned int index = 0) const
+    {
+        if (size == 0)
+            return;
+        size_t count = index < _s.length() ? _s.copy(buffer, size - 1, index) : 0;
+        buffer[count] = '\0';
+    }
+    char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    long toInt() const { return atol(_s.c_str()); }
+
+    String &operator+=(const String &rhs) { _s += rhs._s; return *this; }
+    String &operator+=(const char *rhs) { _s += rhs; return *this; }
+    String &operator+=(char rhs) { _s += rhs; return *this; }
+    bool operator==(const String &rhs) const { return _s == rhs._s; }
+    bool operator!=(const String &rhs) const { return _s != rhs._s; }
+
+    friend String operator+(const String &lhs, const String &rhs) { return String(lhs._s + rhs._s); }
+    friend String operator+(const String &lhs, const char *rhs) { return String(lhs._s + rhs); }
+    friend String operator+(const char *lhs, const String &rhs) { return String(lhs + rhs._s); }
+    friend String operator+(const String &lhs, char rhs) { return String(lhs._s + rhs); }
+    friend String operator+(const String &lhs, int rhs) { return lhs + String(rhs); }
+    friend String operator+(const String &lhs, unsigned int rhs) { return lhs + String(rhs); }
+    friend String operator+(const String &lhs, long rhs) { return lhs + String(rhs); }
+    friend String operator+(const String &lhs, unsigned long rhs) { return lhs + String(rhs); }
+
+private:
+    std::string _s;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+    size_t print(const char *str) { return write(str); }
+    size_t print(const __FlashStringHelper *str) { return write((const char *)str); }
+    size_t print(const String &str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned int value) { return print(String(value)); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t print(double value, int digits = 2) { return print(String(value, digits)); }
+
+    size_t println() { return write("\r\n"); }
+    template<class T> size_t println(T value) { return print(value) + println(); }
+    size_t println(double value, int digits) { return print(value, digits) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() = 0;
+};
+
+// Serial is the host's stdin/stdout, handy for the examples' debug output.
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) {}
+    void end() {}
+    int available();
+    int peek();
+    int read();
+    int availableForWrite() { return 4096; }
+    void flush();
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
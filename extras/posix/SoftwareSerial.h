@@ -0,0 +1,25 @@
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include <Arduino.h>
+
+// Placeholder so code written for SoftwareSerial still compiles on a host.
+// It never receives anything; use PosixSerialContainer for a real port.
+class SoftwareSerial : public Stream
+{
+public:
+    SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverseLogic = false) {}
+    void begin(long speed) {}
+    void end() {}
+    bool listen() { return true; }
+    bool isListening() { return true; }
+    bool overflow() { return false; }
+    int available() { return 0; }
+    int peek() { return -1; }
+    int read() { return -1; }
+    void flush() {}
+    size_t write(uint8_t data) { return 1; }
+    using Print::write;
+};
+
+#endif
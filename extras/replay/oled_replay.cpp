@@ -0,0 +1,86 @@
+// Replays a FourDuino wire recording against a display on a tty (or a simulator on a pty)
+// and prints the throughput. Build from the library root:
+//
+//   g++ -std=gnu++11 -Iextras/posix -I. *.cpp extras/posix/*.cpp extras/replay/oled_replay.cpp -o oled_replay
+//   ./oled_replay session.4drc /dev/ttyUSB0 [runs]
+//
+// Recordings normally start with the autobaud command, so the display is reset before
+// every run by pulsing DTR, which 4D's programming cable wires to its reset pin. A port
+// without modem lines (a pty) can't do that: the display has to be freshly reset by hand,
+// and only one run is possible.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <vector>
+
+#include "FourDuino.h"
+#include "PosixSerialContainer.h"
+#include "OLEDReplay.h"
+
+// Holds the display in reset, then waits for it to come up listening for autobaud at
+// 9600, with nothing left over from the last run. False if the port has no DTR line.
+static bool resetDisplay(PosixSerialContainer &port)
+{
+    int dtr = TIOCM_DTR;
+    if (ioctl(port.getFd(), TIOCMBIS, &dtr) != 0)
+        return false;
+    delay(OLED_RESET_DELAY_MS);
+    ioctl(port.getFd(), TIOCMBIC, &dtr);
+    delay(OLED_INIT_DELAY_MS);
+    port.begin(9600);
+    while (port.available())
+        port.read();
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s recording device [runs]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (!file)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> recording;
+    uint8_t buffer[4096];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        recording.insert(recording.end(), buffer, buffer + got);
+    fclose(file);
+
+    PosixSerialContainer port(argv[2]);
+    port.begin(9600);
+    if (!port.isOpen())
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    int runs = argc > 3 ? atoi(argv[3]) : 1;
+    OLEDReplay replay(port);
+    bool clean = true;
+    for (int r = 0; r < runs; r++)
+    {
+        if (!resetDisplay(port) && r > 0)
+        {
+            fprintf(stderr, "%s: can't reset the display between runs (no DTR)\n", argv[2]);
+            return 1;
+        }
+        if (!replay.run(recording.data(), recording.size()))
+        {
+            fprintf(stderr, "%s: malformed recording\n", argv[1]);
+            return 1;
+        }
+        replay.printReport(Serial);
+        clean = clean && replay.getResult().mismatches == 0 && replay.getResult().timeouts == 0;
+    }
+    Serial.flush();
+    return clean ? 0 : 1;
+}